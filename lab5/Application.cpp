@@ -10,8 +10,12 @@
 ///  This file should not be modified by students.
 ///
 
+#include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <thread>
+#include <chrono>
 
 #if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
@@ -28,10 +32,15 @@
 #include <GLFW/glfw3.h>
 
 #include "ShaderSetup.h"
+#include "ShaderVariants.h"
 #include "Types.h"
 #include "Buffers.h"
+#include "BufferPool.h"
 #include "Canvas.h"
 #include "Utils.h"
+#include "UniformBlocks.h"
+#include "Backend.h"
+#include "FilterBackend.h"
 
 #include "Application.h"
 #include "Viewing.h"
@@ -70,15 +79,36 @@ static bool updateDisplay = true;
 static const char *vshader    = "texture.vert";
 static const char *fshader    = "texture.frag";
 
-/// our Canvas
-static Canvas *canvas;
+/// one pool of buffers holds all our shapes, and their handles in it
+static BufferPool pool;
+static int meshes[N_OBJECTS];
 
-/// buffers for our shapes
-static BufferSet buffers[N_OBJECTS];
-
-/// shader program handle
+/// shader program handle (the basic variant)
 static GLuint program;
 
+/// when profiling, the backend the calls go to (NULL when drawing)
+static Backend *profiler = NULL;
+
+/// is there no window or context?  (profiling with anything but OpenGL)
+#define HEADLESS    (profiler != NULL && profiler != &glBackend)
+
+/// how many frames to draw when profiling
+#define PROFILE_FRAMES  100
+
+/// where a profiling run with the recording backend leaves the stream
+static const char *streamFile = "commands.bin";
+
+/// the buffers a rippling grid is streamed through when profiling,
+/// the grid's size, and how often its triangulation changes (in frames)
+static BufferSet streamed;
+#define RIPPLE_CELLS    16
+#define RIPPLE_FLIP     10
+
+/// the size of the grid the vertex layouts are compared on, and how
+/// many times its vertices are fetched
+#define LAYOUT_CELLS    512
+#define LAYOUT_PASSES   20
+
 ///
 /// PUBLIC GLOBALS
 ///
@@ -106,15 +136,17 @@ GLFWwindow *w_window;
 ///
 
 ///
-/// createShape() - create vertex and element buffers for a shape
+/// buildShape() - build a shape in a Canvas
+///
+/// Runs on a worker thread, so it must not make any OpenGL calls.
 ///
 /// @param obj - which shape to create
 /// @param C   - the Canvas to use
 ///
-static void createShape( int obj, Canvas &C )
+static void buildShape( int obj, Canvas &C )
 {
     // clear any previous shape
-    canvas->clear();
+    C.clear();
 
     // verify the validity of the object
     if( obj < 0 || obj >= N_OBJECTS ) {
@@ -131,8 +163,71 @@ static void createShape( int obj, Canvas &C )
     default:            makeQuad( C );      break;
     }
 
-    // create the necessary buffers
-    buffers[obj].createBuffers( C );
+    // the welding and packing are done lazily; do them here, on
+    // this thread, rather than when the buffers are created
+    Interleaving ifmt;
+    CompactFormat cfmt;
+    switch( pool.layout ) {
+    case VL_COMPACT:      C.viewCompact( cfmt );      break;
+    case VL_INTERLEAVED:  C.viewInterleaved( ifmt );  break;
+    default:              C.numVertices();            break;
+    }
+}
+
+///
+/// createShapes() - put all the shapes into the buffer pool
+///
+/// Each shape is built in its own Canvas on its own thread; the
+/// shapes are then uploaded here, as OpenGL calls must all be made
+/// from the thread that owns the context.  Once uploaded, the
+/// Canvases are no longer needed.
+///
+static void createShapes( void )
+{
+    Canvas *shards[N_OBJECTS];
+    thread workers[N_OBJECTS];
+
+    for( int obj = 0; obj < N_OBJECTS; ++obj ) {
+        shards[obj] = new Canvas( w_width, w_height );
+
+        // weld shared vertices so that each is uploaded (and shaded) once
+        shards[obj]->setIndexed( true );
+
+        workers[obj] = thread( buildShape, obj, ref( *shards[obj] ) );
+    }
+
+    // once they're all built, we know how big the pool must be
+    int nVerts = 0, nElems = 0;
+    for( int obj = 0; obj < N_OBJECTS; ++obj ) {
+        workers[obj].join();
+        nVerts += shards[obj]->numVertices();
+        nElems += shards[obj]->numIndices();
+    }
+
+    pool.destroyPool();
+    pool.reserve( nVerts, nElems );
+    for( int obj = 0; obj < N_OBJECTS; ++obj ) {
+        meshes[obj] = pool.addMesh( *shards[obj] );
+        delete shards[obj];
+    }
+}
+
+///
+/// profileTarget() - which backend does a command-line argument select
+///     for profiling?
+///
+/// @param arg - the argument
+/// @return the backend, or NULL if the argument doesn't select one
+///
+static Backend *profileTarget( const char *arg )
+{
+    switch( arg[0] ) {
+    case 'g':  return( &glBackend );
+    case 'n':  return( &nullBackend );
+    case 'r':  return( &recordingBackend );
+    }
+
+    return( NULL );
 }
 
 ///
@@ -239,6 +334,13 @@ static void keyboard( GLFWwindow *window, int key, int scan,
         lightpos[2] += 1.0f;
         break;
 
+    // Change the shading model
+
+    case GLFW_KEY_M: // Phong, then flat, then Gouraud
+        shading = shading == 0 ? SV_FLAT :
+                  shading == SV_FLAT ? SV_GOURAUD : 0;
+        break;
+
     // Print out potentially useful information
 
     case GLFW_KEY_R: // rotation angles
@@ -278,32 +380,49 @@ static void keyboard( GLFWwindow *window, int key, int scan,
 }
 
 ///
-/// Display the current image
+/// Set up the per-frame parameters for a shader program
 ///
-static void display( void )
+/// @param prog  the program
+///
+static void setScene( GLuint prog )
 {
-    // clear the frame buffer
-    glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
-
-    checkErrors( "display start" );
-
-    // select the shader program
-    glUseProgram( program );
-
     // set up projection parameters
-    setFrustum( program );
+    setFrustum( prog );
 
     // set up the view transformation
-    setCamera( program );
+    setCamera( prog );
 
     // set up lighting for the scene
-    setLighting( program );
+    setLighting( prog );
 
     checkErrors( "display scene" );
 
+    // all the objects share one set of buffers and attributes
+    pool.selectPool( prog, "vPosition", NULL, "vNormal", "vTexCoord" );
+}
+
+///
+/// Display the current image
+///
+static void display( void )
+{
+    // clear the frame buffer
+    if( !HEADLESS ) {
+        glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+    }
+
+    checkErrors( "display start" );
+
+    // the program in use, which changes when an object needs a
+    // different shader variant
+    GLuint current = 0;
+
     // draw the individual objects
     for( int obj = 0; obj < N_OBJECTS; ++obj ) {
 
+        // each object has its own blocks
+        selectObject( obj );
+
         // are we texture mapping this object?
         if( map_obj[obj] ) {
             usingTextures = true;
@@ -311,8 +430,14 @@ static void display( void )
             usingTextures = false;
         }
 
-        // set up texture/shading information
-        setTextures( program, obj );
+        // set up texture/shading information; this selects the
+        // shader variant, which gets the scene parameters first
+        // if it wasn't the one in use
+        GLuint prog = setTextures( program, obj );
+        if( prog != current ) {
+            setScene( prog );
+            current = prog;
+        }
 
         checkErrors( "display object 1" );
 
@@ -322,27 +447,31 @@ static void display( void )
         // send all the transformation data
         switch( obj ) {
         case OBJ_QUAD:
-            setTransforms( program, quad_s, rotations, quad_x );
+            setTransforms( prog, quad_s, rotations, quad_x );
             break;
         case OBJ_SPHERE:
-            setTransforms( program, sphere_s, rotations, sphere_x );
+            setTransforms( prog, sphere_s, rotations, sphere_x );
             break;
         case OBJ_CYLINDER:  // FALL THROUGH
         case OBJ_DISCS:
-            setTransforms( program, cyl_s, rotations, cyl_x );
+            setTransforms( prog, cyl_s, rotations, cyl_x );
             break;
         }
 
         checkErrors( "display object 2" );
 
         // draw it
-        buffers[obj].selectBuffers( program,
-            "vPosition", NULL, "vNormal", "vTexCoord" );
+        pool.selectDecoding( meshes[obj], prog,
+                             "packedNormals", "uvTransform" );
 
         checkErrors( "display object 3" );
 
-        glDrawElements( GL_TRIANGLES, buffers[obj].numElements,
-                        GL_UNSIGNED_INT, (void *)0 );
+        // upload what changed, and bind this object's blocks
+        if( usesUniformBlocks( prog ) ) {
+            commitBlocks();
+        }
+
+        pool.drawMesh( meshes[obj] );
 
         checkErrors( "display object 4" );
     }
@@ -353,52 +482,338 @@ static void display( void )
 ///
 static bool init( void )
 {
-    // Create our Canvas "object"
-    canvas = new Canvas( w_width, w_height );
-
-    if( canvas == NULL ) {
-        cerr << "error - cannot create Canvas" << endl;
-        return( false );
-    }
-
-    // Load shaders and use the resulting shader program
+    // Most of what display() sends is the same from one frame to the
+    // next; drop the calls that wouldn't change anything
+    setFilterTarget( profiler ? profiler : &glBackend );
+    setBackend( &filterBackend );
+
+    // Load shaders and use the resulting shader program; where we
+    // can, the parameters are passed in uniform blocks.  The other
+    // variants are compiled as the objects need them.
     ShaderError error;
-    program = shaderSetup( vshader, fshader, &error );
+    program = 0;
+    if( uniformBlocksAvailable() ) {
+        variantSources( vshader, fshader, SV_UNIFORM_BLOCKS );
+        program = variantProgram( 0, &error );
+    }
+    if( !program ) {
+        variantSources( vshader, fshader, 0 );
+        program = variantProgram( 0, &error );
+    }
     if( !program ) {
         cerr << "Error setting up shaders - "
              << errorString(error) << endl;
         return( false );
     }
 
-    glUseProgram( program );
+    backend->useProgram( program );
 
     // OpenGL state initialization
-    glEnable( GL_DEPTH_TEST );
-    glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
-    glClearColor( 0.0, 0.0, 0.0, 0.0 );
-    glDepthFunc( GL_LEQUAL );
-    glClearDepth( 1.0f );
+    if( !HEADLESS ) {
+        glEnable( GL_DEPTH_TEST );
+        glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
+        glClearColor( 0.0, 0.0, 0.0, 0.0 );
+        glDepthFunc( GL_LEQUAL );
+        glClearDepth( 1.0f );
+    }
 
-    // for each object, set its initial animation status and create it
+    // for each object, set its initial animation status
     for( int obj = 0; obj < N_OBJECTS; ++obj ) {
         animating[obj] = false;
         angles[obj] = 0.0f;
-        createShape( obj, *canvas );
     }
 
-    // initialize all texture-related things
-    initTextures();
+    // keep each vertex's attributes together, and quantized,
+    // for better locality and less bandwidth
+    pool.setLayout( VL_COMPACT );
 
-    // register our callbacks
-    glfwSetKeyCallback( w_window, keyboard );
+    // create them all
+    createShapes();
+
+    // when profiling there is no context or window:  the textures
+    // are loaded by OpenGL calls outside the backend, and there are
+    // no key presses
+    if( !HEADLESS ) {
+        // initialize all texture-related things
+        initTextures();
+    }
+    if( !profiler ) {
+        // register our callbacks
+        glfwSetKeyCallback( w_window, keyboard );
+    }
 
     return( true );
 }
 
+///
+/// Build one frame of a rippling grid, whose vertices change every
+/// frame and whose triangulation changes every RIPPLE_FLIP frames
+///
+/// @param C         the Canvas to build it in
+/// @param frame     the frame number
+/// @param cells     the number of cells along each side
+/// @param textured  should the vertices have (u,v) data?
+///
+static void buildRipple( Canvas &C, int frame, int cells, bool textured )
+{
+    const float step = 2.0f / cells;
+    bool flip = (frame / RIPPLE_FLIP) % 2 != 0;
+
+    C.clear();
+    for( int i = 0; i < cells; ++i ) {
+        for( int j = 0; j < cells; ++j ) {
+            // the height is 0.1 sin(4(x+y) + phase); the normals come
+            // from its slope, so shared corners weld together
+            Vertex v[4];
+            Normal n[4];
+            TexCoord t[4];
+            for( int k = 0; k < 4; ++k ) {
+                float x = -1.0f + (i + (k & 1)) * step;
+                float y = -1.0f + (j + (k >> 1)) * step;
+                float a = 4.0f * (x + y) + 0.2f * frame;
+                float slope = -0.4f * cosf( a );
+                v[k] = (Vertex) { x, y, 0.1f * sinf( a ), 1.0f };
+                n[k] = (Normal) { slope, slope, 1.0f };
+                t[k] = (TexCoord) { 0.5f * (x + 1.0f), 0.5f * (y + 1.0f) };
+            }
+            // corners are numbered 0 1 / 2 3; the diagonal either
+            // joins 0 and 3 or 1 and 2
+            static const int order[2][6] = {
+                { 0, 1, 3, 0, 3, 2 }, { 0, 1, 2, 1, 3, 2 }
+            };
+            const int *o = order[flip];
+            for( int k = 0; k < 6; k += 3 ) {
+                C.addTriangleWithNorms( v[o[k]], n[o[k]], v[o[k+1]],
+                                        n[o[k+1]], v[o[k+2]], n[o[k+2]] );
+                if( textured ) {
+                    C.addTextureCoords( t[o[k]], t[o[k+1]], t[o[k+2]] );
+                }
+            }
+        }
+    }
+}
+
+///
+/// Stream the rippling grid through dynamic buffers for a fixed number
+/// of frames, and report what that took
+///
+static void profileStreaming( void )
+{
+    long uploaded = 0;
+    Canvas ripple( w_width, w_height );
+
+    ripple.setIndexed( true );
+    streamed.setDynamic( true );
+
+    // the grid is drawn as one more untextured object, with the
+    // quad's material and placement, by the variant that calls for
+    GLfloat rotations[3] = { 0.0f, 0.0f, 0.0f };
+    selectObject( N_OBJECTS );
+    usingTextures = false;
+    GLuint prog = setTextures( program, OBJ_QUAD );
+    setScene( prog );
+    setTransforms( prog, quad_s, rotations, quad_x );
+
+    for( int i = 0; i < PROFILE_FRAMES; ++i ) {
+        buildRipple( ripple, i, RIPPLE_CELLS, false );
+        streamed.updateBuffers( ripple );
+        streamed.selectBuffers( prog, "vPosition", NULL, "vNormal", NULL );
+        streamed.selectDecoding( prog, "packedNormals", "uvTransform" );
+        if( usesUniformBlocks( prog ) ) {
+            commitBlocks();
+        }
+        streamed.drawBuffers();
+        uploaded += streamed.uploadBytes;
+        checkErrors( "streaming" );
+    }
+
+    fprintf( stderr, "%d frames of a dynamic object:  %ld bytes sent, "
+             "%lu vertex array objects\n", PROFILE_FRAMES, uploaded,
+             (unsigned long) streamed.vaos.size() );
+}
+
+///
+/// The vertex stage of a software renderer:  fetch each vertex that
+/// the elements name, transform its position, light its normal, and
+/// use its (u,v) data, as the vertex shader does
+///
+/// Each attribute is read through its own base and stride (in floats),
+/// so the same code walks separate arrays and interleaved records.
+///
+/// @param C       the Canvas whose elements are followed
+/// @param pos     the positions (XYZW)
+/// @param pStride their stride
+/// @param nrm     the normals (XYZ)
+/// @param nStride their stride
+/// @param uv      the (u,v) data
+/// @param tStride its stride
+///
+/// @return a sum of the results, so that none of the work is skipped
+///
+static double shadeVertices( Canvas &C,
+                             const float *pos, int pStride,
+                             const float *nrm, int nStride,
+                             const float *uv, int tStride )
+{
+    // a perspective-like transform, and a light from over the shoulder
+    static const float m[16] = {
+        1.2f, 0.0f, 0.0f, 0.0f,    0.0f, 1.2f, 0.0f, 0.0f,
+        0.0f, 0.0f, -1.0f, -1.0f,  0.0f, 0.0f, -0.2f, 1.0f
+    };
+    static const float light[3] = { 0.3f, 0.4f, 0.866f };
+
+    const GLvoid *elements = C.viewElements();
+    bool shortElements = C.elementType() == GL_UNSIGNED_SHORT;
+    int n = C.numIndices();
+    double sum = 0.0;
+
+    for( int i = 0; i < n; ++i ) {
+        int e = shortElements ? ((const GLushort *) elements)[i]
+                              : (int) ((const GLuint *) elements)[i];
+        const float *p = pos + e * pStride;
+        const float *q = nrm + e * nStride;
+        const float *t = uv + e * tStride;
+
+        float clip[4];
+        for( int r = 0; r < 4; ++r ) {
+            clip[r] = m[r] * p[0] + m[4+r] * p[1] + m[8+r] * p[2] +
+                      m[12+r] * p[3];
+        }
+        float diffuse = q[0] * light[0] + q[1] * light[1] +
+                        q[2] * light[2];
+        diffuse = diffuse > 0.0f ? diffuse : 0.0f;
+
+        sum += clip[0] / clip[3] + clip[1] / clip[3] +
+               diffuse * (t[0] + t[1]);
+    }
+
+    return( sum );
+}
+
+///
+/// Compare how quickly the vertex stage can fetch the vertices of a
+/// large grid from separate arrays and from interleaved records
+///
+static void profileLayouts( void )
+{
+    Canvas grid( w_width, w_height );
+
+    grid.setIndexed( true );
+    buildRipple( grid, 0, LAYOUT_CELLS, true );
+
+    AttribView pos = grid.viewVertices();
+    AttribView nrm = grid.viewNormals();
+    AttribView uv = grid.viewUV();
+    Interleaving fmt;
+    const float *rec = grid.viewInterleaved( fmt ).data;
+    if( pos.data == NULL || nrm.data == NULL || uv.data == NULL ||
+        rec == NULL || fmt.normal < 0 || fmt.uv < 0 ) {
+        cerr << "profileLayouts: the grid is missing attributes" << endl;
+        return;
+    }
+
+    const char *names[2] = { "separate", "interleaved" };
+    double sums[2] = { 0.0, 0.0 };
+    for( int layout = 0; layout < 2; ++layout ) {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for( int i = 0; i < LAYOUT_PASSES; ++i ) {
+            if( layout == 0 ) {
+                sums[layout] += shadeVertices( grid, pos.data, 4,
+                                               nrm.data, 3, uv.data, 2 );
+            } else {
+                sums[layout] += shadeVertices( grid,
+                    rec + fmt.position, fmt.stride,
+                    rec + fmt.normal, fmt.stride,
+                    rec + fmt.uv, fmt.stride );
+            }
+        }
+        chrono::duration<double> secs = chrono::steady_clock::now() - start;
+
+        double fetched = (double) grid.numIndices() * LAYOUT_PASSES;
+        fprintf( stderr, "%s layout:  %.0f vertices fetched, %.1f "
+                 "million/second\n", names[layout], fetched,
+                 fetched / secs.count() / 1.0e6 );
+    }
+
+    if( sums[0] != sums[1] ) {
+        cerr << "profileLayouts: the layouts gave different results"
+             << endl;
+    }
+}
+
+///
+/// Draw a fixed number of frames, with every object turning, and
+/// report what was asked of the backend
+///
+static void profile( void )
+{
+    for( int obj = 0; obj < N_OBJECTS; ++obj ) {
+        animating[obj] = true;
+    }
+
+    // the first frame compiles the shaders and fills the buffers;
+    // only the frames after it are counted
+    display();
+    backendReset();
+    for( int i = 1; i < PROFILE_FRAMES; ++i ) {
+        animate();
+        display();
+    }
+
+    fprintf( stderr, "%d frames after the first:\n", PROFILE_FRAMES - 1 );
+    setBackend( profiler );
+    if( HEADLESS ) {
+        backendReport( stderr );
+    }
+    filterReport( stderr );
+
+    if( profiler == &recordingBackend ) {
+        size_t size;
+        const unsigned char *cmds = backendStream( &size );
+        FILE *fp = fopen( streamFile, "wb" );
+        if( fp == NULL || fwrite( cmds, 1, size, fp ) != size ) {
+            perror( streamFile );
+        } else {
+            fprintf( stderr, "%lu bytes of commands written to %s\n",
+                     (unsigned long) size, streamFile );
+        }
+        if( fp != NULL ) {
+            fclose( fp );
+        }
+    }
+
+    // the dynamic buffers' calls are counted on their own, after
+    // the frames' stream has been saved
+    backendReset();
+    profileStreaming();
+    if( HEADLESS ) {
+        backendReport( stderr );
+    }
+
+    // the vertex layouts are compared on the CPU, so this makes no
+    // backend calls at all
+    profileLayouts();
+}
+
 ///
 /// PUBLIC FUNCTIONS
 ///
 
+///
+/// Does this run need a window (and an OpenGL context)?
+///
+bool needWindow( int argc, char *argv[] )
+{
+    for( int i = 1; i < argc; ++i ) {
+        Backend *target = profileTarget( argv[i] );
+        if( target != NULL && target != &glBackend ) {
+            return( false );
+        }
+    }
+
+    return( true );
+}
+
 ///
 /// Assignment-specific processing
 ///
@@ -425,6 +840,11 @@ void application( int argc, char *argv[] )
         case 'x':
             mapAll = false;
             break;
+        case 'g':  // FALL THROUGH
+        case 'n':  // FALL THROUGH
+        case 'r':  // profile with OpenGL, or the null or recording backend
+            profiler = profileTarget( argv[i] );
+            break;
         default:
             cerr << "bad object character '" << argv[i][0]
                  << "' ignored" << endl;
@@ -442,6 +862,11 @@ void application( int argc, char *argv[] )
         return;
     }
 
+    if( profiler ) {
+        profile();
+        return;
+    }
+
     // loop until it's time to quit
     while( !glfwWindowShouldClose(w_window) ) {
         animate();
@@ -452,4 +877,7 @@ void application( int argc, char *argv[] )
         }
         glfwPollEvents();
     }
+
+    // report how many of the calls were redundant
+    filterReport( stderr );
 }
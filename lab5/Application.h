@@ -56,6 +56,16 @@ extern GLFWwindow *w_window;
 /// PUBLIC FUNCTIONS
 ///
 
+///
+/// Does this run need a window (and an OpenGL context)?  Not when the
+/// command line asks for profiling through the null ('n') or
+/// recording ('r') backend.
+///
+/// @param argc, argv  the command line
+/// @return true if a window is needed
+///
+bool needWindow( int argc, char *argv[] );
+
 ///
 /// Assignment-specific processing
 ///
@@ -0,0 +1,1059 @@
+///
+//  Backend.cpp
+//
+//  Rendering backend implementations
+//
+//  This file should not be modified by students.
+///
+
+#include <cstring>
+#include <vector>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#ifndef __APPLE__
+#include <GL/glew.h>
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include "Backend.h"
+
+using namespace std;
+
+///
+/// PRIVATE GLOBALS
+///
+
+/// printable names of the calls, in BackendCall order
+static const char *callNames[N_BACKEND_CALLS] = {
+    "glGenBuffers", "glBindBuffer", "glBufferData", "glBufferSubData",
+    "glMapBufferRange", "glUnmapBuffer", "glCopyBufferSubData",
+    "glDeleteBuffers",
+    "glGenVertexArrays", "glBindVertexArray", "glDeleteVertexArrays",
+    "glEnableVertexAttribArray", "glVertexAttribPointer",
+    "glDrawElements", "glDrawElementsBaseVertex",
+    "glCreateShader", "glShaderSource", "glCompileShader",
+    "glGetShaderiv", "glGetShaderInfoLog", "glDeleteShader",
+    "glCreateProgram", "glAttachShader", "glLinkProgram", "glUseProgram",
+    "glGetProgramiv", "glGetProgramInfoLog", "glDeleteProgram",
+    "glGetAttribLocation", "glGetUniformLocation",
+    "glGetActiveAttrib", "glGetActiveUniform",
+    "glProgramParameteri", "glGetProgramBinary", "glProgramBinary",
+    "glUniform1i", "glUniform1f", "glUniform4f", "glUniform3fv",
+    "glUniform4fv", "glUniformMatrix4fv",
+    "glBindBufferBase", "glBindBufferRange",
+    "glGetUniformBlockIndex", "glUniformBlockBinding",
+    "glActiveTexture", "glBindTexture", "glGenTextures",
+    "glTexParameteri", "glTexImage2D",
+    "glGetString", "glGetIntegerv", "glGetError"
+};
+
+/// counts kept by the null and recording backends
+static long callCounts[N_BACKEND_CALLS];
+static long dataBytes;
+
+/// the recorded command stream
+static vector<unsigned char> stream;
+
+/// next object name handed out by the null and recording backends
+static GLuint nextName = 1;
+
+/// memory handed out by their glMapBufferRange(); only one buffer is
+/// mapped at a time
+static vector<unsigned char> mapped;
+
+///
+/// PRIVATE FUNCTIONS
+///
+
+///
+/// The OpenGL backend
+///
+/// These can't simply be the OpenGL functions themselves, as GLEW
+/// doesn't provide those until it has been initialized.
+///
+
+static void gl_genBuffers( GLsizei n, GLuint *buffers ) {
+    glGenBuffers( n, buffers );
+}
+
+static void gl_bindBuffer( GLenum target, GLuint buffer ) {
+    glBindBuffer( target, buffer );
+}
+
+static void gl_bufferData( GLenum target, GLsizeiptr size,
+                           const GLvoid *data, GLenum usage ) {
+    glBufferData( target, size, data, usage );
+}
+
+static void gl_bufferSubData( GLenum target, GLintptr offset,
+                              GLsizeiptr size, const GLvoid *data ) {
+    glBufferSubData( target, offset, size, data );
+}
+
+static void *gl_mapBufferRange( GLenum target, GLintptr offset,
+                                GLsizeiptr length, GLbitfield access ) {
+    return( glMapBufferRange( target, offset, length, access ) );
+}
+
+static GLboolean gl_unmapBuffer( GLenum target ) {
+    return( glUnmapBuffer( target ) );
+}
+
+static void gl_copyBufferSubData( GLenum readTarget, GLenum writeTarget,
+                                  GLintptr readOffset, GLintptr writeOffset,
+                                  GLsizeiptr size ) {
+    glCopyBufferSubData( readTarget, writeTarget, readOffset, writeOffset,
+                         size );
+}
+
+static void gl_deleteBuffers( GLsizei n, const GLuint *buffers ) {
+    glDeleteBuffers( n, buffers );
+}
+
+static void gl_genVertexArrays( GLsizei n, GLuint *arrays ) {
+    glGenVertexArrays( n, arrays );
+}
+
+static void gl_bindVertexArray( GLuint array ) {
+    glBindVertexArray( array );
+}
+
+static void gl_deleteVertexArrays( GLsizei n, const GLuint *arrays ) {
+    glDeleteVertexArrays( n, arrays );
+}
+
+static void gl_enableVertexAttribArray( GLuint index ) {
+    glEnableVertexAttribArray( index );
+}
+
+static void gl_vertexAttribPointer( GLuint index, GLint size, GLenum type,
+                                    GLboolean normalized, GLsizei stride,
+                                    const GLvoid *pointer ) {
+    glVertexAttribPointer( index, size, type, normalized, stride, pointer );
+}
+
+static void gl_drawElements( GLenum mode, GLsizei count, GLenum type,
+                             const GLvoid *indices ) {
+    glDrawElements( mode, count, type, indices );
+}
+
+static void gl_drawElementsBaseVertex( GLenum mode, GLsizei count,
+                                       GLenum type, const GLvoid *indices,
+                                       GLint basevertex ) {
+    glDrawElementsBaseVertex( mode, count, type, (GLvoid *) indices,
+                              basevertex );
+}
+
+static GLuint gl_createShader( GLenum type ) {
+    return( glCreateShader( type ) );
+}
+
+static void gl_shaderSource( GLuint shader, GLsizei count,
+                             const GLchar **string, const GLint *length ) {
+    glShaderSource( shader, count, string, length );
+}
+
+static void gl_compileShader( GLuint shader ) {
+    glCompileShader( shader );
+}
+
+static void gl_getShaderiv( GLuint shader, GLenum pname, GLint *params ) {
+    glGetShaderiv( shader, pname, params );
+}
+
+static void gl_getShaderInfoLog( GLuint shader, GLsizei bufSize,
+                                 GLsizei *length, GLchar *infoLog ) {
+    glGetShaderInfoLog( shader, bufSize, length, infoLog );
+}
+
+static void gl_deleteShader( GLuint shader ) {
+    glDeleteShader( shader );
+}
+
+static GLuint gl_createProgram( void ) {
+    return( glCreateProgram() );
+}
+
+static void gl_attachShader( GLuint program, GLuint shader ) {
+    glAttachShader( program, shader );
+}
+
+static void gl_linkProgram( GLuint program ) {
+    glLinkProgram( program );
+}
+
+static void gl_useProgram( GLuint program ) {
+    glUseProgram( program );
+}
+
+static void gl_getProgramiv( GLuint program, GLenum pname, GLint *params ) {
+    glGetProgramiv( program, pname, params );
+}
+
+static void gl_getProgramInfoLog( GLuint program, GLsizei bufSize,
+                                  GLsizei *length, GLchar *infoLog ) {
+    glGetProgramInfoLog( program, bufSize, length, infoLog );
+}
+
+static void gl_deleteProgram( GLuint program ) {
+    glDeleteProgram( program );
+}
+
+static GLint gl_getAttribLocation( GLuint program, const GLchar *name ) {
+    return( glGetAttribLocation( program, name ) );
+}
+
+static GLint gl_getUniformLocation( GLuint program, const GLchar *name ) {
+    return( glGetUniformLocation( program, name ) );
+}
+
+static void gl_getActiveAttrib( GLuint program, GLuint index,
+                                GLsizei bufSize, GLsizei *length,
+                                GLint *size, GLenum *type, GLchar *name ) {
+    glGetActiveAttrib( program, index, bufSize, length, size, type, name );
+}
+
+static void gl_getActiveUniform( GLuint program, GLuint index,
+                                 GLsizei bufSize, GLsizei *length,
+                                 GLint *size, GLenum *type, GLchar *name ) {
+    glGetActiveUniform( program, index, bufSize, length, size, type, name );
+}
+
+static void gl_programParameteri( GLuint program, GLenum pname,
+                                  GLint value ) {
+    glProgramParameteri( program, pname, value );
+}
+
+static void gl_getProgramBinary( GLuint program, GLsizei bufSize,
+                                 GLsizei *length, GLenum *binaryFormat,
+                                 GLvoid *binary ) {
+    glGetProgramBinary( program, bufSize, length, binaryFormat, binary );
+}
+
+static void gl_programBinary( GLuint program, GLenum binaryFormat,
+                              const GLvoid *binary, GLsizei length ) {
+    glProgramBinary( program, binaryFormat, binary, length );
+}
+
+static void gl_uniform1i( GLint location, GLint v0 ) {
+    glUniform1i( location, v0 );
+}
+
+static void gl_uniform1f( GLint location, GLfloat v0 ) {
+    glUniform1f( location, v0 );
+}
+
+static void gl_uniform4f( GLint location, GLfloat v0, GLfloat v1,
+                          GLfloat v2, GLfloat v3 ) {
+    glUniform4f( location, v0, v1, v2, v3 );
+}
+
+static void gl_uniform3fv( GLint location, GLsizei count,
+                           const GLfloat *value ) {
+    glUniform3fv( location, count, value );
+}
+
+static void gl_uniform4fv( GLint location, GLsizei count,
+                           const GLfloat *value ) {
+    glUniform4fv( location, count, value );
+}
+
+static void gl_uniformMatrix4fv( GLint location, GLsizei count,
+                                 GLboolean transpose, const GLfloat *value ) {
+    glUniformMatrix4fv( location, count, transpose, value );
+}
+
+static void gl_bindBufferBase( GLenum target, GLuint index, GLuint buffer ) {
+    glBindBufferBase( target, index, buffer );
+}
+
+static void gl_bindBufferRange( GLenum target, GLuint index, GLuint buffer,
+                                GLintptr offset, GLsizeiptr size ) {
+    glBindBufferRange( target, index, buffer, offset, size );
+}
+
+static GLuint gl_getUniformBlockIndex( GLuint program,
+                                       const GLchar *uniformBlockName ) {
+    return( glGetUniformBlockIndex( program, uniformBlockName ) );
+}
+
+static void gl_uniformBlockBinding( GLuint program, GLuint uniformBlockIndex,
+                                    GLuint uniformBlockBinding ) {
+    glUniformBlockBinding( program, uniformBlockIndex, uniformBlockBinding );
+}
+
+static void gl_activeTexture( GLenum texture ) {
+    glActiveTexture( texture );
+}
+
+static void gl_bindTexture( GLenum target, GLuint texture ) {
+    glBindTexture( target, texture );
+}
+
+static void gl_genTextures( GLsizei n, GLuint *textures ) {
+    glGenTextures( n, textures );
+}
+
+static void gl_texParameteri( GLenum target, GLenum pname, GLint param ) {
+    glTexParameteri( target, pname, param );
+}
+
+static void gl_texImage2D( GLenum target, GLint level, GLint internalformat,
+                           GLsizei width, GLsizei height, GLint border,
+                           GLenum format, GLenum type, const GLvoid *pixels ) {
+    glTexImage2D( target, level, internalformat, width, height, border,
+                  format, type, pixels );
+}
+
+static const GLubyte *gl_getString( GLenum name ) {
+    return( glGetString( name ) );
+}
+
+static void gl_getIntegerv( GLenum pname, GLint *data ) {
+    glGetIntegerv( pname, data );
+}
+
+static GLenum gl_getError( void ) {
+    return( glGetError() );
+}
+
+#ifdef __APPLE__
+///
+/// versionAtLeast(maj,min) - is the current context at least this
+///     version of OpenGL?
+///
+static bool versionAtLeast( int maj, int min ) {
+    const char *v = (const char *) glGetString( GL_VERSION );
+    int vmaj = 0, vmin = 0;
+
+    if( v == NULL || sscanf( v, "%d.%d", &vmaj, &vmin ) != 2 ) {
+        return( false );
+    }
+
+    return( vmaj > maj || (vmaj == maj && vmin >= min) );
+}
+#endif
+
+///
+/// gl_hasCapability(cap) - ask the context about a feature; the answer
+///     can't change while the context exists, so each is asked once
+///
+static GLboolean gl_hasCapability( Capability cap ) {
+    // 0 if not asked yet, otherwise 1 + the answer
+    static int known[N_CAPABILITIES];
+
+    if( known[cap] == 0 ) {
+        bool has = false;
+#ifdef __APPLE__
+        switch( cap ) {
+        case CAP_MAP_BUFFER_RANGE:  // FALL THROUGH
+        case CAP_VERTEX_ARRAYS:     has = versionAtLeast( 3, 0 ); break;
+        case CAP_COPY_BUFFER:       // FALL THROUGH
+        case CAP_UNIFORM_BLOCKS:    has = versionAtLeast( 3, 1 ); break;
+        case CAP_BASE_VERTEX:       has = versionAtLeast( 3, 2 ); break;
+        // the macOS OpenGL reports no program binary formats
+        case CAP_PROGRAM_BINARY:    has = false; break;
+        default:                    break;
+        }
+#else
+        switch( cap ) {
+        case CAP_MAP_BUFFER_RANGE:
+            has = GLEW_VERSION_3_0 || GLEW_ARB_map_buffer_range;
+            break;
+        case CAP_VERTEX_ARRAYS:
+            has = GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object;
+            break;
+        case CAP_COPY_BUFFER:
+            has = GLEW_VERSION_3_1 || GLEW_ARB_copy_buffer;
+            break;
+        case CAP_UNIFORM_BLOCKS:
+            has = GLEW_VERSION_3_1 || GLEW_ARB_uniform_buffer_object;
+            break;
+        case CAP_BASE_VERTEX:
+            has = GLEW_VERSION_3_2 || GLEW_ARB_draw_elements_base_vertex;
+            break;
+        case CAP_PROGRAM_BINARY:
+            has = GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary;
+            break;
+        default:
+            break;
+        }
+#endif
+        known[cap] = has ? 2 : 1;
+    }
+
+    return( known[cap] == 2 );
+}
+
+///
+/// The null and recording backends
+///
+/// Each function is instantiated twice:  with REC true for the
+/// recording backend, and false for the null backend.  Whether a call
+/// is recorded thus depends on which backend's function was called,
+/// not on which backend is current, so the recording backend also
+/// records the calls that another backend (e.g., the filter) passes on
+/// to it.
+///
+
+///
+/// note() - count a call, and record it if we're recording
+///
+/// @param record  is it to be added to the command stream?
+/// @param call    the call
+/// @param nargs   number of integer arguments
+/// @param args    the arguments
+/// @param data    data passed with the call (or NULL)
+/// @param bytes   length of the data
+///
+static void note( bool record, BackendCall call, int nargs,
+                  const long long *args, const void *data, size_t bytes ) {
+    callCounts[call] += 1;
+    dataBytes += bytes;
+
+    if( !record ) {
+        return;
+    }
+
+    BackendCommand cmd;
+    cmd.call = call;
+    cmd.nargs = nargs;
+    cmd.bytes = data != NULL ? bytes : 0;
+
+    const unsigned char *h = (const unsigned char *) &cmd;
+    const unsigned char *a = (const unsigned char *) args;
+    const unsigned char *d = (const unsigned char *) data;
+    stream.insert( stream.end(), h, h + sizeof(cmd) );
+    stream.insert( stream.end(), a, a + nargs * sizeof(long long) );
+    stream.insert( stream.end(), d, d + cmd.bytes );
+}
+
+///
+/// newNames() - hand out n new object names
+///
+static void newNames( GLsizei n, GLuint *names ) {
+    for( GLsizei i = 0; i < n; ++i ) {
+        names[i] = nextName++;
+    }
+}
+
+///
+/// pixelBytes() - how big is one pixel of a texture image?
+///
+static size_t pixelBytes( GLenum format, GLenum type ) {
+    size_t n;
+
+    switch( format ) {
+    case GL_RED:  case GL_ALPHA:  case GL_LUMINANCE:  n = 1;  break;
+    case GL_RG:   case GL_LUMINANCE_ALPHA:            n = 2;  break;
+    case GL_RGB:  case GL_BGR:                        n = 3;  break;
+    default:                                          n = 4;  break;
+    }
+
+    return( type == GL_FLOAT ? n * sizeof(GLfloat) : n );
+}
+
+template <bool REC>
+static void null_genBuffers( GLsizei n, GLuint *buffers ) {
+    long long args[] = { n };
+    note( REC, BC_GEN_BUFFERS, 1, args, NULL, 0 );
+    newNames( n, buffers );
+}
+
+template <bool REC>
+static void null_bindBuffer( GLenum target, GLuint buffer ) {
+    long long args[] = { target, buffer };
+    note( REC, BC_BIND_BUFFER, 2, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_bufferData( GLenum target, GLsizeiptr size,
+                             const GLvoid *data, GLenum usage ) {
+    long long args[] = { target, size, usage };
+    note( REC, BC_BUFFER_DATA, 3, args, data, data != NULL ? size : 0 );
+}
+
+template <bool REC>
+static void null_bufferSubData( GLenum target, GLintptr offset,
+                                GLsizeiptr size, const GLvoid *data ) {
+    long long args[] = { target, offset, size };
+    note( REC, BC_BUFFER_SUB_DATA, 3, args, data, size );
+}
+
+template <bool REC>
+static void *null_mapBufferRange( GLenum target, GLintptr offset,
+                                  GLsizeiptr length, GLbitfield access ) {
+    long long args[] = { target, offset, length, access };
+    note( REC, BC_MAP_BUFFER_RANGE, 4, args, NULL, 0 );
+    mapped.assign( length, 0 );
+    return( mapped.data() );
+}
+
+template <bool REC>
+static GLboolean null_unmapBuffer( GLenum target ) {
+    long long args[] = { target };
+    // whatever was written to the mapping is the data
+    note( REC, BC_UNMAP_BUFFER, 1, args, mapped.data(), mapped.size() );
+    mapped.clear();
+    return( GL_TRUE );
+}
+
+template <bool REC>
+static void null_copyBufferSubData( GLenum readTarget, GLenum writeTarget,
+                                    GLintptr readOffset, GLintptr writeOffset,
+                                    GLsizeiptr size ) {
+    long long args[] = { readTarget, writeTarget, readOffset, writeOffset,
+                         size };
+    note( REC, BC_COPY_BUFFER_SUB_DATA, 5, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_deleteBuffers( GLsizei n, const GLuint *buffers ) {
+    long long args[] = { n, n > 0 ? buffers[0] : 0 };
+    note( REC, BC_DELETE_BUFFERS, 2, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_genVertexArrays( GLsizei n, GLuint *arrays ) {
+    long long args[] = { n };
+    note( REC, BC_GEN_VERTEX_ARRAYS, 1, args, NULL, 0 );
+    newNames( n, arrays );
+}
+
+template <bool REC>
+static void null_bindVertexArray( GLuint array ) {
+    long long args[] = { array };
+    note( REC, BC_BIND_VERTEX_ARRAY, 1, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_deleteVertexArrays( GLsizei n, const GLuint *arrays ) {
+    long long args[] = { n, n > 0 ? arrays[0] : 0 };
+    note( REC, BC_DELETE_VERTEX_ARRAYS, 2, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_enableVertexAttribArray( GLuint index ) {
+    long long args[] = { index };
+    note( REC, BC_ENABLE_VERTEX_ATTRIB_ARRAY, 1, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_vertexAttribPointer( GLuint index, GLint size, GLenum type,
+                                      GLboolean normalized, GLsizei stride,
+                                      const GLvoid *pointer ) {
+    long long args[] = { index, size, type, normalized, stride,
+                         (long long) (size_t) pointer };
+    note( REC, BC_VERTEX_ATTRIB_POINTER, 6, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_drawElements( GLenum mode, GLsizei count, GLenum type,
+                               const GLvoid *indices ) {
+    long long args[] = { mode, count, type, (long long) (size_t) indices };
+    note( REC, BC_DRAW_ELEMENTS, 4, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_drawElementsBaseVertex( GLenum mode, GLsizei count,
+                                         GLenum type, const GLvoid *indices,
+                                         GLint basevertex ) {
+    long long args[] = { mode, count, type, (long long) (size_t) indices,
+                         basevertex };
+    note( REC, BC_DRAW_ELEMENTS_BASE_VERTEX, 5, args, NULL, 0 );
+}
+
+template <bool REC>
+static GLuint null_createShader( GLenum type ) {
+    GLuint id;
+    long long args[] = { type };
+    note( REC, BC_CREATE_SHADER, 1, args, NULL, 0 );
+    newNames( 1, &id );
+    return( id );
+}
+
+template <bool REC>
+static void null_shaderSource( GLuint shader, GLsizei count,
+                               const GLchar **string, const GLint *length ) {
+    long long args[] = { shader, count };
+    // the source strings are joined together as the data
+    vector<GLchar> text;
+    for( GLsizei i = 0; i < count; ++i ) {
+        size_t n = length != NULL && length[i] >= 0 ? length[i]
+                                                    : strlen( string[i] );
+        text.insert( text.end(), string[i], string[i] + n );
+    }
+    note( REC, BC_SHADER_SOURCE, 2, args, text.data(), text.size() );
+}
+
+template <bool REC>
+static void null_compileShader( GLuint shader ) {
+    long long args[] = { shader };
+    note( REC, BC_COMPILE_SHADER, 1, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_getShaderiv( GLuint shader, GLenum pname, GLint *params ) {
+    long long args[] = { shader, pname };
+    note( REC, BC_GET_SHADERIV, 2, args, NULL, 0 );
+    *params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+template <bool REC>
+static void null_getShaderInfoLog( GLuint shader, GLsizei bufSize,
+                                   GLsizei *length, GLchar *infoLog ) {
+    long long args[] = { shader, bufSize };
+    note( REC, BC_GET_SHADER_INFO_LOG, 2, args, NULL, 0 );
+    if( length != NULL ) *length = 0;
+    if( bufSize > 0 ) infoLog[0] = '\0';
+}
+
+template <bool REC>
+static void null_deleteShader( GLuint shader ) {
+    long long args[] = { shader };
+    note( REC, BC_DELETE_SHADER, 1, args, NULL, 0 );
+}
+
+template <bool REC>
+static GLuint null_createProgram( void ) {
+    GLuint id;
+    note( REC, BC_CREATE_PROGRAM, 0, NULL, NULL, 0 );
+    newNames( 1, &id );
+    return( id );
+}
+
+template <bool REC>
+static void null_attachShader( GLuint program, GLuint shader ) {
+    long long args[] = { program, shader };
+    note( REC, BC_ATTACH_SHADER, 2, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_linkProgram( GLuint program ) {
+    long long args[] = { program };
+    note( REC, BC_LINK_PROGRAM, 1, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_useProgram( GLuint program ) {
+    long long args[] = { program };
+    note( REC, BC_USE_PROGRAM, 1, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_getProgramiv( GLuint program, GLenum pname, GLint *params ) {
+    long long args[] = { program, pname };
+    note( REC, BC_GET_PROGRAMIV, 2, args, NULL, 0 );
+    *params = (pname == GL_LINK_STATUS || pname == GL_VALIDATE_STATUS) ?
+              GL_TRUE : 0;
+}
+
+template <bool REC>
+static void null_getProgramInfoLog( GLuint program, GLsizei bufSize,
+                                    GLsizei *length, GLchar *infoLog ) {
+    long long args[] = { program, bufSize };
+    note( REC, BC_GET_PROGRAM_INFO_LOG, 2, args, NULL, 0 );
+    if( length != NULL ) *length = 0;
+    if( bufSize > 0 ) infoLog[0] = '\0';
+}
+
+template <bool REC>
+static void null_deleteProgram( GLuint program ) {
+    long long args[] = { program };
+    note( REC, BC_DELETE_PROGRAM, 1, args, NULL, 0 );
+}
+
+template <bool REC>
+static GLint null_getAttribLocation( GLuint program, const GLchar *name ) {
+    long long args[] = { program };
+    note( REC, BC_GET_ATTRIB_LOCATION, 1, args, name, strlen( name ) );
+    return( 0 );
+}
+
+template <bool REC>
+static GLint null_getUniformLocation( GLuint program, const GLchar *name ) {
+    long long args[] = { program };
+    note( REC, BC_GET_UNIFORM_LOCATION, 1, args, name, strlen( name ) );
+    return( 0 );
+}
+
+template <bool REC>
+static void null_getActiveAttrib( GLuint program, GLuint index,
+                                  GLsizei bufSize, GLsizei *length,
+                                  GLint *size, GLenum *type, GLchar *name ) {
+    long long args[] = { program, index };
+    note( REC, BC_GET_ACTIVE_ATTRIB, 2, args, NULL, 0 );
+    if( length != NULL ) *length = 0;
+    *size = 0;
+    *type = GL_FLOAT;
+    if( bufSize > 0 ) name[0] = '\0';
+}
+
+template <bool REC>
+static void null_getActiveUniform( GLuint program, GLuint index,
+                                   GLsizei bufSize, GLsizei *length,
+                                   GLint *size, GLenum *type, GLchar *name ) {
+    long long args[] = { program, index };
+    note( REC, BC_GET_ACTIVE_UNIFORM, 2, args, NULL, 0 );
+    if( length != NULL ) *length = 0;
+    *size = 0;
+    *type = GL_FLOAT;
+    if( bufSize > 0 ) name[0] = '\0';
+}
+
+template <bool REC>
+static void null_programParameteri( GLuint program, GLenum pname,
+                                    GLint value ) {
+    long long args[] = { program, pname, value };
+    note( REC, BC_PROGRAM_PARAMETERI, 3, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_getProgramBinary( GLuint program, GLsizei bufSize,
+                                   GLsizei *length, GLenum *binaryFormat,
+                                   GLvoid *binary ) {
+    long long args[] = { program, bufSize };
+    note( REC, BC_GET_PROGRAM_BINARY, 2, args, NULL, 0 );
+    // the binary is empty, so nothing is written to it
+    (void) binary;
+    if( length != NULL ) *length = 0;
+    *binaryFormat = 0;
+}
+
+template <bool REC>
+static void null_programBinary( GLuint program, GLenum binaryFormat,
+                                const GLvoid *binary, GLsizei length ) {
+    long long args[] = { program, binaryFormat };
+    note( REC, BC_PROGRAM_BINARY, 2, args, binary, length );
+}
+
+template <bool REC>
+static void null_uniform1i( GLint location, GLint v0 ) {
+    long long args[] = { location, v0 };
+    note( REC, BC_UNIFORM1I, 2, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_uniform1f( GLint location, GLfloat v0 ) {
+    long long args[] = { location };
+    note( REC, BC_UNIFORM1F, 1, args, &v0, sizeof(v0) );
+}
+
+template <bool REC>
+static void null_uniform4f( GLint location, GLfloat v0, GLfloat v1,
+                            GLfloat v2, GLfloat v3 ) {
+    long long args[] = { location };
+    GLfloat v[4] = { v0, v1, v2, v3 };
+    note( REC, BC_UNIFORM4F, 1, args, v, sizeof(v) );
+}
+
+template <bool REC>
+static void null_uniform3fv( GLint location, GLsizei count,
+                             const GLfloat *value ) {
+    long long args[] = { location, count };
+    note( REC, BC_UNIFORM3FV, 2, args, value, count * 3 * sizeof(GLfloat) );
+}
+
+template <bool REC>
+static void null_uniform4fv( GLint location, GLsizei count,
+                             const GLfloat *value ) {
+    long long args[] = { location, count };
+    note( REC, BC_UNIFORM4FV, 2, args, value, count * 4 * sizeof(GLfloat) );
+}
+
+template <bool REC>
+static void null_uniformMatrix4fv( GLint location, GLsizei count,
+                                   GLboolean transpose,
+                                   const GLfloat *value ) {
+    long long args[] = { location, count, transpose };
+    note( REC, BC_UNIFORM_MATRIX4FV, 3, args, value,
+          count * 16 * sizeof(GLfloat) );
+}
+
+template <bool REC>
+static void null_bindBufferBase( GLenum target, GLuint index,
+                                 GLuint buffer ) {
+    long long args[] = { target, index, buffer };
+    note( REC, BC_BIND_BUFFER_BASE, 3, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_bindBufferRange( GLenum target, GLuint index,
+                                  GLuint buffer, GLintptr offset,
+                                  GLsizeiptr size ) {
+    long long args[] = { target, index, buffer, offset, size };
+    note( REC, BC_BIND_BUFFER_RANGE, 5, args, NULL, 0 );
+}
+
+template <bool REC>
+static GLuint null_getUniformBlockIndex( GLuint program,
+                                         const GLchar *uniformBlockName ) {
+    long long args[] = { program };
+    note( REC, BC_GET_UNIFORM_BLOCK_INDEX, 1, args, uniformBlockName,
+          strlen( uniformBlockName ) );
+    return( 0 );
+}
+
+template <bool REC>
+static void null_uniformBlockBinding( GLuint program,
+                                      GLuint uniformBlockIndex,
+                                      GLuint uniformBlockBinding ) {
+    long long args[] = { program, uniformBlockIndex, uniformBlockBinding };
+    note( REC, BC_UNIFORM_BLOCK_BINDING, 3, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_activeTexture( GLenum texture ) {
+    long long args[] = { texture };
+    note( REC, BC_ACTIVE_TEXTURE, 1, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_bindTexture( GLenum target, GLuint texture ) {
+    long long args[] = { target, texture };
+    note( REC, BC_BIND_TEXTURE, 2, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_genTextures( GLsizei n, GLuint *textures ) {
+    long long args[] = { n };
+    note( REC, BC_GEN_TEXTURES, 1, args, NULL, 0 );
+    newNames( n, textures );
+}
+
+template <bool REC>
+static void null_texParameteri( GLenum target, GLenum pname, GLint param ) {
+    long long args[] = { target, pname, param };
+    note( REC, BC_TEX_PARAMETERI, 3, args, NULL, 0 );
+}
+
+template <bool REC>
+static void null_texImage2D( GLenum target, GLint level, GLint internalformat,
+                             GLsizei width, GLsizei height, GLint border,
+                             GLenum format, GLenum type,
+                             const GLvoid *pixels ) {
+    long long args[] = { target, level, internalformat, width, height,
+                         border, format, type };
+    size_t bytes = pixels != NULL ?
+                   (size_t) width * height * pixelBytes( format, type ) : 0;
+    note( REC, BC_TEX_IMAGE_2D, 8, args, pixels, bytes );
+}
+
+template <bool REC>
+static const GLubyte *null_getString( GLenum name ) {
+    long long args[] = { name };
+    note( REC, BC_GET_STRING, 1, args, NULL, 0 );
+    return( (const GLubyte *) (name == GL_VERSION ? "3.0 (no context)" :
+                               "none") );
+}
+
+template <bool REC>
+static void null_getIntegerv( GLenum pname, GLint *data ) {
+    long long args[] = { pname };
+    note( REC, BC_GET_INTEGERV, 1, args, NULL, 0 );
+    *data = pname == GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT ? 256 : 0;
+}
+
+template <bool REC>
+static GLenum null_getError( void ) {
+    note( REC, BC_GET_ERROR, 0, NULL, NULL, 0 );
+    return( GL_NO_ERROR );
+}
+
+// everything but program binaries, which are empty here and so would
+// only be written to the cache to be rejected later
+static GLboolean null_hasCapability( Capability cap ) {
+    return( cap != CAP_PROGRAM_BINARY );
+}
+
+///
+/// PUBLIC GLOBALS
+///
+
+Backend glBackend = {
+    "OpenGL",
+    gl_genBuffers, gl_bindBuffer, gl_bufferData, gl_bufferSubData,
+    gl_mapBufferRange, gl_unmapBuffer, gl_copyBufferSubData,
+    gl_deleteBuffers,
+    gl_genVertexArrays, gl_bindVertexArray, gl_deleteVertexArrays,
+    gl_enableVertexAttribArray, gl_vertexAttribPointer,
+    gl_drawElements, gl_drawElementsBaseVertex,
+    gl_createShader, gl_shaderSource, gl_compileShader,
+    gl_getShaderiv, gl_getShaderInfoLog, gl_deleteShader,
+    gl_createProgram, gl_attachShader, gl_linkProgram,
+    gl_useProgram,
+    gl_getProgramiv, gl_getProgramInfoLog, gl_deleteProgram,
+    gl_getAttribLocation, gl_getUniformLocation,
+    gl_getActiveAttrib, gl_getActiveUniform,
+    gl_programParameteri, gl_getProgramBinary, gl_programBinary,
+    gl_uniform1i, gl_uniform1f, gl_uniform4f, gl_uniform3fv,
+    gl_uniform4fv, gl_uniformMatrix4fv,
+    gl_bindBufferBase, gl_bindBufferRange,
+    gl_getUniformBlockIndex, gl_uniformBlockBinding,
+    gl_activeTexture, gl_bindTexture, gl_genTextures,
+    gl_texParameteri, gl_texImage2D,
+    gl_getString, gl_getIntegerv, gl_getError,
+    gl_hasCapability
+};
+
+// the null and recording backends share their functions, which differ
+// only in whether note() records the calls
+#define NULL_BACKEND(name,R) {                                            \
+    name,                                                                  \
+    null_genBuffers<R>, null_bindBuffer<R>, null_bufferData<R>,            \
+    null_bufferSubData<R>, null_mapBufferRange<R>, null_unmapBuffer<R>,    \
+    null_copyBufferSubData<R>, null_deleteBuffers<R>,                      \
+    null_genVertexArrays<R>, null_bindVertexArray<R>,                      \
+    null_deleteVertexArrays<R>, null_enableVertexAttribArray<R>,           \
+    null_vertexAttribPointer<R>, null_drawElements<R>,                     \
+    null_drawElementsBaseVertex<R>, null_createShader<R>,                  \
+    null_shaderSource<R>, null_compileShader<R>, null_getShaderiv<R>,      \
+    null_getShaderInfoLog<R>, null_deleteShader<R>, null_createProgram<R>, \
+    null_attachShader<R>, null_linkProgram<R>, null_useProgram<R>,         \
+    null_getProgramiv<R>, null_getProgramInfoLog<R>,                       \
+    null_deleteProgram<R>, null_getAttribLocation<R>,                      \
+    null_getUniformLocation<R>, null_getActiveAttrib<R>,                   \
+    null_getActiveUniform<R>, null_programParameteri<R>,                   \
+    null_getProgramBinary<R>, null_programBinary<R>, null_uniform1i<R>,    \
+    null_uniform1f<R>, null_uniform4f<R>, null_uniform3fv<R>,              \
+    null_uniform4fv<R>, null_uniformMatrix4fv<R>, null_bindBufferBase<R>,  \
+    null_bindBufferRange<R>, null_getUniformBlockIndex<R>,                 \
+    null_uniformBlockBinding<R>, null_activeTexture<R>,                    \
+    null_bindTexture<R>, null_genTextures<R>, null_texParameteri<R>,       \
+    null_texImage2D<R>, null_getString<R>, null_getIntegerv<R>,            \
+    null_getError<R>, null_hasCapability                                   \
+}
+
+Backend nullBackend = NULL_BACKEND( "null", false );
+
+Backend recordingBackend = NULL_BACKEND( "recording", true );
+
+Backend *backend = &glBackend;
+
+///
+/// PUBLIC FUNCTIONS
+///
+
+///
+/// Select the backend to use for subsequent calls
+///
+/// @param b  the new backend (NULL selects glBackend)
+/// @return   the previous backend
+///
+Backend *setBackend( Backend *b ) {
+    Backend *old = backend;
+
+    backend = b != NULL ? b : &glBackend;
+    return( old );
+}
+
+///
+/// Get the name of a backend call
+///
+/// @param call  the call
+/// @return its name (the OpenGL function name)
+///
+const char *backendCallName( BackendCall call ) {
+    if( call < 0 || call >= N_BACKEND_CALLS ) {
+        return( "unknown" );
+    }
+
+    return( callNames[call] );
+}
+
+///
+/// Get the number of times a call was made through the null or
+/// recording backend since the last reset
+///
+/// @param call  the call
+/// @return the count
+///
+long backendCalls( BackendCall call ) {
+    if( call < 0 || call >= N_BACKEND_CALLS ) {
+        return( 0 );
+    }
+
+    return( callCounts[call] );
+}
+
+///
+/// Get the number of bytes of data passed through the null or
+/// recording backend since the last reset
+///
+/// @return the byte count
+///
+long backendBytes( void ) {
+    return( dataBytes );
+}
+
+///
+/// Clear the call and byte counts and the recorded command stream
+///
+void backendReset( void ) {
+    memset( callCounts, 0, sizeof(callCounts) );
+    dataBytes = 0;
+    stream.clear();
+}
+
+///
+/// Print the call and byte counts
+///
+/// @param fp  where to print them
+///
+void backendReport( FILE *fp ) {
+    long total = 0;
+
+    fprintf( fp, "Backend '%s' calls:\n", backend->name );
+    for( int i = 0; i < N_BACKEND_CALLS; ++i ) {
+        if( callCounts[i] > 0 ) {
+            fprintf( fp, "  %-28s %ld\n", callNames[i], callCounts[i] );
+            total += callCounts[i];
+        }
+    }
+    fprintf( fp, "  total: %ld calls, %ld bytes of data\n", total,
+             dataBytes );
+}
+
+///
+/// Get the recorded command stream
+///
+/// @param size  where to return the length of the stream (bytes)
+/// @return the stream
+///
+const unsigned char *backendStream( size_t *size ) {
+    *size = stream.size();
+    return( stream.data() );
+}
+
+///
+/// Print the recorded command stream in readable form
+///
+/// @param fp  where to print it
+///
+void backendDump( FILE *fp ) {
+    size_t pos = 0;
+
+    while( pos + sizeof(BackendCommand) <= stream.size() ) {
+        BackendCommand cmd;
+        memcpy( &cmd, &stream[pos], sizeof(cmd) );
+        pos += sizeof(cmd);
+
+        fprintf( fp, "%s(", backendCallName( (BackendCall) cmd.call ) );
+        for( int i = 0; i < cmd.nargs; ++i ) {
+            long long arg;
+            memcpy( &arg, &stream[pos], sizeof(arg) );
+            pos += sizeof(arg);
+            fprintf( fp, "%s %lld", i ? "," : "", arg );
+        }
+        fprintf( fp, " )" );
+        if( cmd.bytes > 0 ) {
+            fprintf( fp, " + %u bytes", cmd.bytes );
+        }
+        fputc( '\n', fp );
+        pos += cmd.bytes;
+    }
+}
@@ -0,0 +1,289 @@
+///
+//  Backend.h
+//
+//  Rendering backend interface
+//
+//  All of the OpenGL calls made by the buffer, shader, viewing,
+//  lighting, and texture modules go through the current backend, so
+//  that they can be counted or recorded instead of executed:
+//
+//     glBackend        - passes each call on to OpenGL
+//     nullBackend      - counts the calls and the bytes of data they
+//                        carry, and does nothing else
+//     recordingBackend - as nullBackend, but also appends each call
+//                        (with its arguments and data) to a command
+//                        stream in memory
+//
+//  Neither of the latter two needs an OpenGL context.  They return
+//  plausible values from queries:  new object IDs count up from 1,
+//  compiles and links succeed, every variable and uniform block has
+//  location 0, uniform buffer ranges are aligned to 256 bytes, and
+//  program binaries are empty.  They report the capabilities of a
+//  context with all of the optional features below except program
+//  binaries, so that they follow the paths a modern driver would.
+//
+//  FilterBackend.h adds a fourth, which drops redundant state changes
+//  and passes the rest on to one of these.
+//
+//  This code can be compiled as either C or C++.
+//
+//  This file should not be modified by students.
+///
+
+#ifndef _BACKEND_H_
+#define _BACKEND_H_
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#ifndef __APPLE__
+#include <GL/glew.h>
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include <stdio.h>
+
+///
+/// The calls a backend provides, for counting and recording
+///
+typedef enum bcall_e {
+    // buffers
+    BC_GEN_BUFFERS, BC_BIND_BUFFER, BC_BUFFER_DATA, BC_BUFFER_SUB_DATA,
+    BC_MAP_BUFFER_RANGE, BC_UNMAP_BUFFER, BC_COPY_BUFFER_SUB_DATA,
+    BC_DELETE_BUFFERS,
+    // vertex arrays and drawing
+    BC_GEN_VERTEX_ARRAYS, BC_BIND_VERTEX_ARRAY, BC_DELETE_VERTEX_ARRAYS,
+    BC_ENABLE_VERTEX_ATTRIB_ARRAY, BC_VERTEX_ATTRIB_POINTER,
+    BC_DRAW_ELEMENTS, BC_DRAW_ELEMENTS_BASE_VERTEX,
+    // shaders and programs
+    BC_CREATE_SHADER, BC_SHADER_SOURCE, BC_COMPILE_SHADER,
+    BC_GET_SHADERIV, BC_GET_SHADER_INFO_LOG, BC_DELETE_SHADER,
+    BC_CREATE_PROGRAM, BC_ATTACH_SHADER, BC_LINK_PROGRAM, BC_USE_PROGRAM,
+    BC_GET_PROGRAMIV, BC_GET_PROGRAM_INFO_LOG, BC_DELETE_PROGRAM,
+    BC_GET_ATTRIB_LOCATION, BC_GET_UNIFORM_LOCATION,
+    BC_GET_ACTIVE_ATTRIB, BC_GET_ACTIVE_UNIFORM,
+    BC_PROGRAM_PARAMETERI, BC_GET_PROGRAM_BINARY, BC_PROGRAM_BINARY,
+    // uniforms
+    BC_UNIFORM1I, BC_UNIFORM1F, BC_UNIFORM4F, BC_UNIFORM3FV,
+    BC_UNIFORM4FV, BC_UNIFORM_MATRIX4FV,
+    // uniform blocks
+    BC_BIND_BUFFER_BASE, BC_BIND_BUFFER_RANGE,
+    BC_GET_UNIFORM_BLOCK_INDEX, BC_UNIFORM_BLOCK_BINDING,
+    // textures
+    BC_ACTIVE_TEXTURE, BC_BIND_TEXTURE, BC_GEN_TEXTURES,
+    BC_TEX_PARAMETERI, BC_TEX_IMAGE_2D,
+    // state queries
+    BC_GET_STRING, BC_GET_INTEGERV, BC_GET_ERROR,
+    // must be last
+    N_BACKEND_CALLS
+} BackendCall;
+
+///
+/// Optional features the code uses when the context has them
+///
+typedef enum bcap_e {
+    CAP_MAP_BUFFER_RANGE,   /// glMapBufferRange()          (GL 3.0)
+    CAP_VERTEX_ARRAYS,      /// vertex array objects        (GL 3.0)
+    CAP_COPY_BUFFER,        /// glCopyBufferSubData()       (GL 3.1)
+    CAP_UNIFORM_BLOCKS,     /// uniform buffer objects      (GL 3.1)
+    CAP_BASE_VERTEX,        /// glDrawElementsBaseVertex()  (GL 3.2)
+    CAP_PROGRAM_BINARY,     /// glGetProgramBinary()        (GL 4.1)
+    // must be last
+    N_CAPABILITIES
+} Capability;
+
+///
+/// A backend:  one function for each OpenGL call, with the same
+/// arguments as the OpenGL function of the same name
+///
+typedef struct st_backend {
+    const char *name;
+
+    // buffers
+    void (*genBuffers)( GLsizei n, GLuint *buffers );
+    void (*bindBuffer)( GLenum target, GLuint buffer );
+    void (*bufferData)( GLenum target, GLsizeiptr size,
+                        const GLvoid *data, GLenum usage );
+    void (*bufferSubData)( GLenum target, GLintptr offset,
+                           GLsizeiptr size, const GLvoid *data );
+    void *(*mapBufferRange)( GLenum target, GLintptr offset,
+                             GLsizeiptr length, GLbitfield access );
+    GLboolean (*unmapBuffer)( GLenum target );
+    void (*copyBufferSubData)( GLenum readTarget, GLenum writeTarget,
+                               GLintptr readOffset, GLintptr writeOffset,
+                               GLsizeiptr size );
+    void (*deleteBuffers)( GLsizei n, const GLuint *buffers );
+
+    // vertex arrays and drawing
+    void (*genVertexArrays)( GLsizei n, GLuint *arrays );
+    void (*bindVertexArray)( GLuint array );
+    void (*deleteVertexArrays)( GLsizei n, const GLuint *arrays );
+    void (*enableVertexAttribArray)( GLuint index );
+    void (*vertexAttribPointer)( GLuint index, GLint size, GLenum type,
+                                 GLboolean normalized, GLsizei stride,
+                                 const GLvoid *pointer );
+    void (*drawElements)( GLenum mode, GLsizei count, GLenum type,
+                          const GLvoid *indices );
+    void (*drawElementsBaseVertex)( GLenum mode, GLsizei count,
+                                    GLenum type, const GLvoid *indices,
+                                    GLint basevertex );
+
+    // shaders and programs
+    GLuint (*createShader)( GLenum type );
+    void (*shaderSource)( GLuint shader, GLsizei count,
+                          const GLchar **string, const GLint *length );
+    void (*compileShader)( GLuint shader );
+    void (*getShaderiv)( GLuint shader, GLenum pname, GLint *params );
+    void (*getShaderInfoLog)( GLuint shader, GLsizei bufSize,
+                              GLsizei *length, GLchar *infoLog );
+    void (*deleteShader)( GLuint shader );
+    GLuint (*createProgram)( void );
+    void (*attachShader)( GLuint program, GLuint shader );
+    void (*linkProgram)( GLuint program );
+    void (*useProgram)( GLuint program );
+    void (*getProgramiv)( GLuint program, GLenum pname, GLint *params );
+    void (*getProgramInfoLog)( GLuint program, GLsizei bufSize,
+                               GLsizei *length, GLchar *infoLog );
+    void (*deleteProgram)( GLuint program );
+    GLint (*getAttribLocation)( GLuint program, const GLchar *name );
+    GLint (*getUniformLocation)( GLuint program, const GLchar *name );
+    void (*getActiveAttrib)( GLuint program, GLuint index, GLsizei bufSize,
+                             GLsizei *length, GLint *size, GLenum *type,
+                             GLchar *name );
+    void (*getActiveUniform)( GLuint program, GLuint index, GLsizei bufSize,
+                              GLsizei *length, GLint *size, GLenum *type,
+                              GLchar *name );
+    void (*programParameteri)( GLuint program, GLenum pname, GLint value );
+    void (*getProgramBinary)( GLuint program, GLsizei bufSize,
+                              GLsizei *length, GLenum *binaryFormat,
+                              GLvoid *binary );
+    void (*programBinary)( GLuint program, GLenum binaryFormat,
+                           const GLvoid *binary, GLsizei length );
+
+    // uniforms
+    void (*uniform1i)( GLint location, GLint v0 );
+    void (*uniform1f)( GLint location, GLfloat v0 );
+    void (*uniform4f)( GLint location, GLfloat v0, GLfloat v1,
+                       GLfloat v2, GLfloat v3 );
+    void (*uniform3fv)( GLint location, GLsizei count, const GLfloat *value );
+    void (*uniform4fv)( GLint location, GLsizei count, const GLfloat *value );
+    void (*uniformMatrix4fv)( GLint location, GLsizei count,
+                              GLboolean transpose, const GLfloat *value );
+
+    // uniform blocks
+    void (*bindBufferBase)( GLenum target, GLuint index, GLuint buffer );
+    void (*bindBufferRange)( GLenum target, GLuint index, GLuint buffer,
+                             GLintptr offset, GLsizeiptr size );
+    GLuint (*getUniformBlockIndex)( GLuint program,
+                                    const GLchar *uniformBlockName );
+    void (*uniformBlockBinding)( GLuint program, GLuint uniformBlockIndex,
+                                 GLuint uniformBlockBinding );
+
+    // textures
+    void (*activeTexture)( GLenum texture );
+    void (*bindTexture)( GLenum target, GLuint texture );
+    void (*genTextures)( GLsizei n, GLuint *textures );
+    void (*texParameteri)( GLenum target, GLenum pname, GLint param );
+    void (*texImage2D)( GLenum target, GLint level, GLint internalformat,
+                        GLsizei width, GLsizei height, GLint border,
+                        GLenum format, GLenum type, const GLvoid *pixels );
+
+    // state queries
+    const GLubyte *(*getString)( GLenum name );
+    void (*getIntegerv)( GLenum pname, GLint *data );
+    GLenum (*getError)( void );
+
+    // does the context have an optional feature?  (not a call, so it
+    // isn't counted or recorded)
+    GLboolean (*hasCapability)( Capability cap );
+} Backend;
+
+///
+/// The available backends, and the current one
+///
+extern Backend glBackend;
+extern Backend nullBackend;
+extern Backend recordingBackend;
+
+extern Backend *backend;
+
+///
+/// Select the backend to use for subsequent calls
+///
+/// @param b  the new backend (NULL selects glBackend)
+/// @return   the previous backend
+///
+Backend *setBackend( Backend *b );
+
+///
+/// Get the name of a backend call
+///
+/// @param call  the call
+/// @return its name (the OpenGL function name)
+///
+const char *backendCallName( BackendCall call );
+
+///
+/// Get the number of times a call was made through the null or
+/// recording backend since the last reset
+///
+/// @param call  the call
+/// @return the count
+///
+long backendCalls( BackendCall call );
+
+///
+/// Get the number of bytes of data (buffer contents, uniform values,
+/// texture images, etc.) passed through the null or recording backend
+/// since the last reset
+///
+/// @return the byte count
+///
+long backendBytes( void );
+
+///
+/// Clear the call and byte counts and the recorded command stream
+///
+void backendReset( void );
+
+///
+/// Print the call and byte counts
+///
+/// @param fp  where to print them
+///
+void backendReport( FILE *fp );
+
+///
+/// Get the recorded command stream
+///
+/// Each command is a BackendCommand header, followed by 'nargs'
+/// 64-bit integer arguments, then 'bytes' bytes of data.  Pointer
+/// arguments are recorded as their values (e.g., buffer offsets);
+/// floating-point arguments are part of the data.  What is written
+/// through a glMapBufferRange() mapping is the data of the matching
+/// glUnmapBuffer().
+///
+/// @param size  where to return the length of the stream (bytes)
+/// @return the stream
+///
+const unsigned char *backendStream( size_t *size );
+
+///
+/// Print the recorded command stream in readable form
+///
+/// @param fp  where to print it
+///
+void backendDump( FILE *fp );
+
+///
+/// Header of one recorded command
+///
+typedef struct st_backendcommand {
+    unsigned short call;    /// a BackendCall
+    unsigned short nargs;   /// number of arguments that follow
+    unsigned int bytes;     /// number of data bytes after them
+} BackendCommand;
+
+#endif
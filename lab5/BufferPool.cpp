@@ -0,0 +1,462 @@
+///
+///  BufferPool.cpp
+///
+///  Implementation of a vertex and element buffer pool shared by
+///  many objects.
+///
+///  Based on Buffers.cpp by Warren R. Carithers
+///
+///  This file should not be modified by students.
+///
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+///
+/// GLEW and GLFW header files also pull in the OpenGL definitions
+///
+
+#ifndef __APPLE__
+#include <GL/glew.h>
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include "BufferPool.h"
+#include "Backend.h"
+
+///
+/// canDrawBaseVertex() - can we use glDrawElementsBaseVertex()?
+///
+static bool canDrawBaseVertex( void ) {
+    return( backend->hasCapability( CAP_BASE_VERTEX ) );
+}
+
+///
+/// canCopyBuffers() - can we use glCopyBufferSubData()?
+///
+static bool canCopyBuffers( void ) {
+    return( backend->hasCapability( CAP_COPY_BUFFER ) );
+}
+
+///
+/// allocate(free,size,align,offset) - take a range from a free list
+///
+/// The first free range big enough is used.
+///
+/// @param free     the free list
+/// @param size     how many bytes are needed
+/// @param align    the alignment the range must start on
+/// @param offset   where to return the start of the range
+///
+/// @return true on success, false if no range is big enough
+///
+static bool allocate( vector<PoolBlock> &free, GLsizeiptr size,
+                      GLsizeiptr align, GLintptr &offset ) {
+
+    for( size_t i = 0; i < free.size(); ++i ) {
+        GLintptr start = (free[i].offset + align - 1) / align * align;
+        GLsizeiptr pad = start - free[i].offset;
+
+        if( free[i].size < pad + size ) {
+            continue;
+        }
+
+        // whatever is left after the range stays free, as does any
+        // padding in front of it
+        PoolBlock after = { start + size, free[i].size - pad - size };
+        if( pad > 0 ) {
+            free[i].size = pad;
+            if( after.size > 0 ) {
+                free.insert( free.begin() + i + 1, after );
+            }
+        } else if( after.size > 0 ) {
+            free[i] = after;
+        } else {
+            free.erase( free.begin() + i );
+        }
+
+        offset = start;
+        return( true );
+    }
+
+    return( false );
+}
+
+///
+/// release(free,offset,size) - return a range to a free list, merging
+///     it with its neighbors
+///
+/// @param free     the free list
+/// @param offset   the start of the range
+/// @param size     its length
+///
+static void release( vector<PoolBlock> &free, GLintptr offset,
+                     GLsizeiptr size ) {
+    size_t i = 0;
+
+    while( i < free.size() && free[i].offset < offset ) {
+        i++;
+    }
+
+    PoolBlock block = { offset, size };
+    free.insert( free.begin() + i, block );
+
+    if( i + 1 < free.size() &&
+        free[i].offset + free[i].size == free[i+1].offset ) {
+        free[i].size += free[i+1].size;
+        free.erase( free.begin() + i + 1 );
+    }
+
+    if( i > 0 && free[i-1].offset + free[i-1].size == free[i].offset ) {
+        free[i-1].size += free[i].size;
+        free.erase( free.begin() + i );
+    }
+}
+
+///
+/// Constructor
+///
+BufferPool::BufferPool( void ) {
+    layout = VL_COMPACT;
+    vCapacity = eCapacity = 0;
+    reserveVerts = reserveElems = 0;
+    poolInit = false;
+}
+
+///
+/// setLayout(layout) - choose the vertex data layout; only takes
+///     effect before the first object is added
+///
+/// @param l   the desired layout
+///
+/// @return the old layout
+///
+VertexLayout BufferPool::setLayout( VertexLayout l ) {
+    VertexLayout old = layout;
+
+    layout = l == VL_SEPARATE ? VL_INTERLEAVED : l;
+    return( old );
+}
+
+///
+/// reserve(nVerts,nElems) - note how much data is coming, so the
+///     buffers can be made big enough to start with
+///
+/// @param nVerts   total number of vertices
+/// @param nElems   total number of indices
+///
+void BufferPool::reserve( int nVerts, int nElems ) {
+    reserveVerts = nVerts;
+    reserveElems = nElems;
+}
+
+///
+/// grow(target,buffer,capacity,free,need) - enlarge one of the
+///     buffers, keeping its contents
+///
+/// @param target     which type of buffer this is
+/// @param buffer     the buffer; replaced by the new one
+/// @param capacity   its size; updated
+/// @param free       its free list; the new space is added to it
+/// @param need       the minimum number of bytes to add
+///
+/// @return true on success
+///
+bool BufferPool::grow( GLenum target, GLuint &buffer, GLsizeiptr &capacity,
+                       vector<PoolBlock> &free, GLsizeiptr need ) {
+
+    if( buffer != 0 && !canCopyBuffers() ) {
+        cerr << "*** BufferPool: pool is full, and can't be enlarged" << endl;
+        return( false );
+    }
+
+    GLsizeiptr size = capacity * 2;
+    if( size < capacity + need ) {
+        size = capacity + need;
+    }
+
+    GLuint old = buffer;
+    buffer = format.makeBuffer( target, NULL, size );
+
+    if( old != 0 ) {
+        backend->bindBuffer( GL_COPY_READ_BUFFER, old );
+        backend->copyBufferSubData( GL_COPY_READ_BUFFER, target, 0, 0, capacity );
+        backend->deleteBuffers( 1, &old );
+    }
+
+    if( size > capacity ) {
+        release( free, capacity, size - capacity );
+    }
+    capacity = size;
+
+    // the vertex array objects refer to the old buffer
+    format.dropVAOs();
+
+    return( true );
+}
+
+///
+/// addMesh(C) - copy the object held in a Canvas into the pool
+///
+/// @param C   the Canvas holding the object
+///
+/// @return a handle for the object, or -1 on error
+///
+int BufferPool::addMesh( Canvas &C ) {
+    int nElems = C.numIndices();
+    int nVerts = C.numVertices();
+
+    if( nElems < 1 ) {
+        cerr << "*** BufferPool: empty object not added" << endl;
+        return( -1 );
+    }
+
+    // buffer bindings are part of the state of a vertex array
+    // object, so make sure we don't disturb one of them
+    if( canUseVAOs() ) {
+        backend->bindVertexArray( 0 );
+    }
+
+    // let a BufferSet get the vertex data in our layout
+    BufferSet mesh;
+    GLsizeiptr vbytes;
+    mesh.setLayout( layout );
+    mesh.numVertices = nVerts;
+    const GLvoid *data = mesh.vertexData( C, vbytes );
+
+    if( !poolInit ) {
+        // the first object decides the vertex format
+        format.initBuffer();
+        format.setLayout( layout );
+        format.packed = mesh.packed;
+        format.stride = mesh.stride;
+        format.vSize = mesh.vSize;
+        format.cSize = mesh.cSize;
+        format.nSize = mesh.nSize;
+        format.tSize = mesh.tSize;
+        format.cOffset = mesh.cOffset;
+        format.nOffset = mesh.nOffset;
+        format.tOffset = mesh.tOffset;
+        format.bufferInit = true;
+        poolInit = true;
+
+        // make the buffers as big as we've been told to expect
+        vCapacity = eCapacity = 0;
+        vFree.clear();
+        eFree.clear();
+        grow( GL_ARRAY_BUFFER, format.vbuffer, vCapacity, vFree,
+              (GLsizeiptr) reserveVerts * format.stride );
+        grow( GL_ELEMENT_ARRAY_BUFFER, format.ebuffer, eCapacity, eFree,
+              (GLsizeiptr) reserveElems * sizeof(GLuint) );
+    } else if( mesh.stride != format.stride ||
+               (mesh.cSize > 0) != (format.cSize > 0) ||
+               (mesh.nSize > 0) != (format.nSize > 0) ||
+               (mesh.tSize > 0) != (format.tSize > 0) ) {
+        cerr << "*** BufferPool: object's vertex format doesn't match"
+             << " the pool's" << endl;
+        return( -1 );
+    }
+
+    // find room for the vertices; each range starts on a vertex
+    // boundary, so it begins with a whole vertex number
+    PoolMesh m;
+    m.vBytes = vbytes;
+    if( !allocate( vFree, vbytes, format.stride, m.vOffset ) ) {
+        if( !grow( GL_ARRAY_BUFFER, format.vbuffer, vCapacity, vFree,
+                   vbytes + format.stride ) ||
+            !allocate( vFree, vbytes, format.stride, m.vOffset ) ) {
+            return( -1 );
+        }
+    }
+    m.baseVertex = m.vOffset / format.stride;
+
+    // get the connectivity; without base vertex support, the
+    // indices must be offset to where the vertices actually are
+    const GLvoid *elements = C.viewElements();
+    m.elemType = C.elementType();
+    m.numElements = nElems;
+    m.rebased = false;
+
+    vector<GLuint> rebased;
+    if( m.baseVertex > 0 && !canDrawBaseVertex() ) {
+        rebased.resize( nElems );
+        for( int i = 0; i < nElems; ++i ) {
+            GLuint index = m.elemType == GL_UNSIGNED_SHORT ?
+                ((const GLushort *) elements)[i] :
+                ((const GLuint *) elements)[i];
+            rebased[i] = index + m.baseVertex;
+        }
+        elements = rebased.data();
+        m.elemType = GL_UNSIGNED_INT;
+        m.rebased = true;
+    }
+
+    m.eBytes = nElems * (m.elemType == GL_UNSIGNED_SHORT ?
+                         sizeof(GLushort) : sizeof(GLuint));
+    if( !allocate( eFree, m.eBytes, sizeof(GLuint), m.eOffset ) ) {
+        if( !grow( GL_ELEMENT_ARRAY_BUFFER, format.ebuffer, eCapacity,
+                   eFree, m.eBytes + sizeof(GLuint) ) ||
+            !allocate( eFree, m.eBytes, sizeof(GLuint), m.eOffset ) ) {
+            release( vFree, m.vOffset, m.vBytes );
+            return( -1 );
+        }
+    }
+
+    // copy everything in
+    backend->bindBuffer( GL_ARRAY_BUFFER, format.vbuffer );
+    backend->bufferSubData( GL_ARRAY_BUFFER, m.vOffset, m.vBytes, data );
+    backend->bindBuffer( GL_ELEMENT_ARRAY_BUFFER, format.ebuffer );
+    backend->bufferSubData( GL_ELEMENT_ARRAY_BUFFER, m.eOffset, m.eBytes, elements );
+
+    m.uvBias[0] = mesh.uvBias[0];
+    m.uvBias[1] = mesh.uvBias[1];
+    m.uvScale[0] = mesh.uvScale[0];
+    m.uvScale[1] = mesh.uvScale[1];
+    m.inUse = true;
+
+    // reuse a released handle if there is one
+    for( size_t i = 0; i < meshes.size(); ++i ) {
+        if( !meshes[i].inUse ) {
+            meshes[i] = m;
+            return( i );
+        }
+    }
+
+    meshes.push_back( m );
+    return( meshes.size() - 1 );
+}
+
+///
+/// removeMesh(id) - release an object's space in the pool
+///
+/// @param id   the handle addMesh() returned
+///
+void BufferPool::removeMesh( int id ) {
+    if( id < 0 || id >= (int) meshes.size() || !meshes[id].inUse ) {
+        return;
+    }
+
+    release( vFree, meshes[id].vOffset, meshes[id].vBytes );
+    release( eFree, meshes[id].eOffset, meshes[id].eBytes );
+    meshes[id].inUse = false;
+}
+
+///
+/// destroyPool() - delete the buffers and forget all the objects
+///
+void BufferPool::destroyPool( void ) {
+    if( poolInit ) {
+        format.dropVAOs();
+        backend->deleteBuffers( 1, &(format.vbuffer) );
+        backend->deleteBuffers( 1, &(format.ebuffer) );
+        format.initBuffer();
+    }
+
+    vCapacity = eCapacity = 0;
+    vFree.clear();
+    eFree.clear();
+    meshes.clear();
+    poolInit = false;
+}
+
+///
+/// selectPool() - bind the shared buffers and attributes
+///
+/// @param program   GLSL program object
+/// @param vp        name of the position attribute variable
+/// @param vc        name of the color attribute variable (or NULL)
+/// @param vn        name of the normal attribute variable (or NULL)
+/// @param vt        name of the texture coord attribute variable (or NULL)
+///
+void BufferPool::selectPool( GLuint program, const char *vp,
+    const char *vc, const char *vn, const char *vt ) {
+
+    format.selectBuffers( program, vp, vc, vn, vt );
+}
+
+///
+/// selectDecoding() - send the uniforms the vertex shader needs to
+///     decode one object's attributes
+///
+/// @param id        the object's handle
+/// @param program   GLSL program object
+/// @param pn        name of the bool "normals are packed" uniform
+/// @param uvx       name of the vec4 (u,v) transform uniform
+///
+void BufferPool::selectDecoding( int id, GLuint program,
+    const char *pn, const char *uvx ) {
+
+    if( id < 0 || id >= (int) meshes.size() ) {
+        return;
+    }
+
+    format.uvBias[0] = meshes[id].uvBias[0];
+    format.uvBias[1] = meshes[id].uvBias[1];
+    format.uvScale[0] = meshes[id].uvScale[0];
+    format.uvScale[1] = meshes[id].uvScale[1];
+    format.selectDecoding( program, pn, uvx );
+}
+
+///
+/// drawMesh(id) - draw one object
+///
+/// @param id   the object's handle
+///
+void BufferPool::drawMesh( int id ) {
+    if( id < 0 || id >= (int) meshes.size() || !meshes[id].inUse ) {
+        return;
+    }
+
+    const PoolMesh &m = meshes[id];
+
+    if( m.baseVertex == 0 || m.rebased ) {
+        backend->drawElements( GL_TRIANGLES, m.numElements, m.elemType,
+                        BUFFER_OFFSET(m.eOffset) );
+    } else {
+        backend->drawElementsBaseVertex( GL_TRIANGLES, m.numElements, m.elemType,
+                                  BUFFER_OFFSET(m.eOffset), m.baseVertex );
+    }
+}
+
+///
+/// dumpPool(which) - dump the contents of the pool
+///
+/// @param which   description of the pool
+///
+void BufferPool::dumpPool( const char *which ) {
+    GLsizeiptr vLeft = 0, eLeft = 0;
+
+    for( size_t i = 0; i < vFree.size(); ++i ) {
+        vLeft += vFree[i].size;
+    }
+    for( size_t i = 0; i < eFree.size(); ++i ) {
+        eLeft += eFree[i].size;
+    }
+
+    cout << "Dumping pool " << which << " (";
+    if( !poolInit ) {
+        cout << "not ";
+    }
+    cout << "initialized)" << endl;
+    cout << "  Vertex buffer: " << vCapacity << " bytes, " << vLeft
+         << " free in " << vFree.size() << " ranges" << endl;
+    cout << "  Element buffer: " << eCapacity << " bytes, " << eLeft
+         << " free in " << eFree.size() << " ranges" << endl;
+    for( size_t i = 0; i < meshes.size(); ++i ) {
+        const PoolMesh &m = meshes[i];
+        if( !m.inUse ) {
+            continue;
+        }
+        cout << "  Object " << i << ": v " << m.vOffset << "+" << m.vBytes
+             << " (base " << m.baseVertex << ") e " << m.eOffset << "+"
+             << m.eBytes << " #elements " << m.numElements
+             << (m.rebased ? " (rebased)" : "") << endl;
+    }
+    format.dumpBuffer( which );
+}
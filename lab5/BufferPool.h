@@ -0,0 +1,191 @@
+///
+///  BufferPool.h
+///
+///  A single vertex buffer and element buffer shared by many objects
+///
+///  Based on Buffers.h by Warren R. Carithers
+///
+///  This file should not be modified by students.
+///
+
+#ifndef _BUFFERPOOL_H_
+#define _BUFFERPOOL_H_
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#ifndef __APPLE__
+#include <GL/glew.h>
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+using namespace std;
+
+#include "Canvas.h"
+#include "Buffers.h"
+
+///
+/// A free range of bytes in one of the pool's buffers
+///
+typedef struct st_poolblock {
+    GLintptr offset;    /// where the range begins
+    GLsizeiptr size;    /// its length
+} PoolBlock;
+
+///
+/// Where one object lives in the pool, and how to draw it
+///
+typedef struct st_poolmesh {
+    bool inUse;             /// is this entry holding an object?
+    GLintptr vOffset;       /// start of its vertex data (bytes)
+    GLsizeiptr vBytes;      /// length of its vertex data
+    GLintptr eOffset;       /// start of its element data (bytes)
+    GLsizeiptr eBytes;      /// length of its element data
+    GLint baseVertex;       /// index of its first vertex in the pool
+    bool rebased;           /// were its indices offset by baseVertex?
+    int numElements;        /// number of indices to draw
+    GLenum elemType;        /// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    float uvBias[2];        /// decoding of quantized (u,v) data
+    float uvScale[2];
+} PoolMesh;
+
+///
+/// The pool itself
+///
+/// All objects must share one vertex format (the first object added
+/// decides it), so that a single set of attribute pointers serves them
+/// all; each object is then drawn from its own range of the buffers
+/// with glDrawElementsBaseVertex().  Where that isn't available, the
+/// indices are offset by the object's first vertex as they're uploaded.
+///
+
+class BufferPool {
+
+public:
+    /// the shared buffers and vertex format, in the form
+    /// BufferSet::selectBuffers() uses
+    BufferSet format;
+
+    /// vertex layout for the objects (VL_INTERLEAVED or VL_COMPACT)
+    VertexLayout layout;
+
+    /// buffer capacities (bytes)
+    GLsizeiptr vCapacity, eCapacity;
+
+    /// expected totals, used to size the buffers when they're made
+    int reserveVerts, reserveElems;
+
+    /// the unused ranges of the buffers, in offset order
+    vector<PoolBlock> vFree, eFree;
+
+    /// the objects, indexed by the handle addMesh() returned
+    vector<PoolMesh> meshes;
+
+    /// have the buffers been created?
+    bool poolInit;
+
+public:
+
+    ///
+    /// Constructor
+    ///
+    BufferPool( void );
+
+    ///
+    /// setLayout(layout) - choose the vertex data layout; only takes
+    ///     effect before the first object is added
+    ///
+    /// @param l   the desired layout (VL_SEPARATE is treated as
+    ///            VL_INTERLEAVED)
+    ///
+    /// @return the old layout
+    ///
+    VertexLayout setLayout( VertexLayout l );
+
+    ///
+    /// reserve(nVerts,nElems) - note how much data is coming, so the
+    ///     buffers can be made big enough to start with
+    ///
+    /// @param nVerts   total number of vertices
+    /// @param nElems   total number of indices
+    ///
+    void reserve( int nVerts, int nElems );
+
+    ///
+    /// addMesh(C) - copy the object held in a Canvas into the pool
+    ///
+    /// @param C   the Canvas holding the object
+    ///
+    /// @return a handle for the object, or -1 on error
+    ///
+    int addMesh( Canvas &C );
+
+    ///
+    /// removeMesh(id) - release an object's space in the pool
+    ///
+    /// @param id   the handle addMesh() returned
+    ///
+    void removeMesh( int id );
+
+    ///
+    /// destroyPool() - delete the buffers and forget all the objects
+    ///
+    void destroyPool( void );
+
+    ///
+    /// selectPool() - bind the shared buffers and attributes; once per
+    ///     frame is enough for all the objects in the pool
+    ///
+    /// @param program   GLSL program object
+    /// @param vp        name of the position attribute variable
+    /// @param vc        name of the color attribute variable (or NULL)
+    /// @param vn        name of the normal attribute variable (or NULL)
+    /// @param vt        name of the texture coord attribute variable (or NULL)
+    ///
+    void selectPool( GLuint program, const char *vp, const char *vc,
+                     const char *vn, const char *vt );
+
+    ///
+    /// selectDecoding() - send the uniforms the vertex shader needs to
+    ///     decode one object's attributes
+    ///
+    /// @param id        the object's handle
+    /// @param program   GLSL program object
+    /// @param pn        name of the bool "normals are packed" uniform
+    /// @param uvx       name of the vec4 (u,v) transform uniform
+    ///
+    void selectDecoding( int id, GLuint program,
+                         const char *pn, const char *uvx );
+
+    ///
+    /// drawMesh(id) - draw one object; selectPool() must be in effect
+    ///
+    /// @param id   the object's handle
+    ///
+    void drawMesh( int id );
+
+    ///
+    /// dumpPool(which) - dump the contents of the pool
+    ///
+    /// @param which   description of the pool
+    ///
+    void dumpPool( const char *which );
+
+private:
+
+    ///
+    /// grow(target,buffer,capacity,free,need) - enlarge one of the
+    ///     buffers, keeping its contents
+    ///
+    /// @return true on success
+    ///
+    bool grow( GLenum target, GLuint &buffer, GLsizeiptr &capacity,
+               vector<PoolBlock> &free, GLsizeiptr need );
+
+};
+
+#endif
@@ -11,6 +11,7 @@
 ///
 
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -29,11 +30,149 @@
 
 #include "Buffers.h"
 #include "Utils.h"
+#include "Backend.h"
+#include "UniformBlocks.h"
+
+///
+/// Static buffers holding identical data are shared between BufferSets
+///
+/// No copy of the data is kept:  a match needs the same layout and
+/// section sizes and the same 64-bit hash of the contents, which is
+/// far less likely to go wrong by chance than the driver is.
+///
+#define SHARED_DESC     10
+
+typedef struct st_sharedbuffers {
+    unsigned long long hash;    /// hash of the contents
+    long desc[SHARED_DESC];     /// the layout and section sizes
+    GLuint vbuffer, ebuffer;    /// the buffers
+    int refs;                   /// number of BufferSets using them
+} SharedBuffers;
+
+static vector<SharedBuffers> sharedBuffers;
+
+///
+/// The handles of the decoding uniforms, the program they're in, and
+/// the names they were looked up by
+///
+static ProgramKey decodeProgram;
+static const char *decodePn, *decodeUvx;
+static UniformInt packedNormalsU;
+static UniformVec4 uvTransformU;
+
+///
+/// FNV-1a hashing, 64-bit version
+///
+#define FNV_BASIS       14695981039346656037ull
+#define FNV_PRIME       1099511628211ull
+
+///
+/// hashBytes(h,data,size) - add some data to an FNV-1a hash
+///
+/// @param h      the hash so far (FNV_BASIS to begin)
+/// @param data   the data
+/// @param size   its length in bytes
+///
+/// @return the new hash
+///
+static unsigned long long hashBytes( unsigned long long h,
+                                     const void *data, size_t size ) {
+    const unsigned char *b = (const unsigned char *) data;
+
+    for( size_t i = 0; i < size; ++i ) {
+        h = (h ^ b[i]) * FNV_PRIME;
+    }
+    return( h );
+}
+
+///
+/// shareBuffers(hash,desc,vb,eb) - look for buffers already holding
+///     some data, and take a reference to them
+///
+/// @param hash   hash of the data
+/// @param desc   the layout and section sizes (see createBuffers())
+/// @param vb     where to return the vertex buffer
+/// @param eb     where to return the element buffer
+///
+/// @return true if they were found
+///
+static bool shareBuffers( unsigned long long hash, const long *desc,
+                          GLuint &vb, GLuint &eb ) {
+    for( size_t i = 0; i < sharedBuffers.size(); ++i ) {
+        SharedBuffers &s = sharedBuffers[i];
+        if( s.hash == hash &&
+            memcmp( s.desc, desc, sizeof(s.desc) ) == 0 ) {
+            s.refs += 1;
+            vb = s.vbuffer;
+            eb = s.ebuffer;
+            return( true );
+        }
+    }
+
+    return( false );
+}
+
+///
+/// addShared(hash,desc,vb,eb) - make newly-filled buffers available
+///     for sharing, with one reference
+///
+static void addShared( unsigned long long hash, const long *desc,
+                       GLuint vb, GLuint eb ) {
+    SharedBuffers s;
+
+    s.hash = hash;
+    memcpy( s.desc, desc, sizeof(s.desc) );
+    s.vbuffer = vb;
+    s.ebuffer = eb;
+    s.refs = 1;
+    sharedBuffers.push_back( s );
+}
+
+///
+/// releaseShared(vb,eb) - drop a reference to shared buffers, deleting
+///     them when the last one goes
+///
+/// @param vb   the vertex buffer
+/// @param eb   the element buffer
+///
+static void releaseShared( GLuint vb, GLuint eb ) {
+    for( size_t i = 0; i < sharedBuffers.size(); ++i ) {
+        if( sharedBuffers[i].vbuffer == vb ) {
+            if( --sharedBuffers[i].refs > 0 ) {
+                return;
+            }
+            sharedBuffers.erase( sharedBuffers.begin() + i );
+            break;
+        }
+    }
+
+    backend->deleteBuffers( 1, &vb );
+    backend->deleteBuffers( 1, &eb );
+}
+
+///
+/// sharedUsers(vb) - how many BufferSets are using a vertex buffer?
+///
+static int sharedUsers( GLuint vb ) {
+    for( size_t i = 0; i < sharedBuffers.size(); ++i ) {
+        if( sharedBuffers[i].vbuffer == vb ) {
+            return( sharedBuffers[i].refs );
+        }
+    }
+
+    return( 0 );
+}
 
 ///
 /// Constructor
 ///
 BufferSet::BufferSet( void ) {
+    // the layout is a setting rather than state, so it survives
+    // initBuffer()
+    layout = VL_SEPARATE;
+    dynamic = false;
+    ringSegments = 3;
+
     // do this the easy way
     initBuffer();
 }
@@ -43,8 +182,26 @@ BufferSet::BufferSet( void ) {
 ///
 void BufferSet::initBuffer( void ) {
     vbuffer = ebuffer = 0;
-    numElements = 0;
+    numElements = numVertices = 0;
+    elemType = GL_UNSIGNED_INT;
     vSize = eSize = tSize = cSize = nSize = 0;
+    stride = 0;
+    cOffset = nOffset = tOffset = 0;
+    canvasMemory = (CanvasMemory) { 0, 0, 0, 0 };
+    packed = false;
+    uvBias[0] = uvBias[1] = 0.0f;
+    uvScale[0] = uvScale[1] = 1.0f;
+    segSize = eCapacity = 0;
+    ringHead = eHead = 0;
+    ringBase = eBase = 0;
+    lastVerts.clear();
+    lastElems.clear();
+    uploadBytes = 0;
+    vaos.clear();
+    vaoSupport = -1;
+    vaoReleased = 0;
+    contentHash = 0;
+    cached = false;
     bufferInit = false;
 }
 
@@ -60,9 +217,64 @@ void BufferSet::dumpBuffer( const char *which ) {
     }
     cout << "initialized)" << endl;
     cout << "  IDs: v " << vbuffer << " e " << ebuffer
-         << " #elements: " << numElements << endl;
+         << " #elements: " << numElements << " #vertices: " << numVertices
+         << " element type: "
+         << (elemType == GL_UNSIGNED_SHORT ? "ushort" : "uint") << endl;
     cout << "  Sizes:  v " << vSize << " e " << eSize << " t "
          << tSize << " c " << cSize << " n " << nSize << endl;
+    cout << "  Layout: " << (layout == VL_COMPACT ? "compact" :
+         layout == VL_INTERLEAVED ? "interleaved" : "separate")
+         << (packed ? " (packed)" : "") << " stride " << stride
+         << " offsets c " << cOffset << " n " << nOffset
+         << " t " << tOffset << endl;
+    if( dynamic ) {
+        cout << "  Dynamic: " << ringSegments << " segments of " << segSize
+             << " bytes, current " << ringHead << " at " << ringBase
+             << ", element segments of " << eCapacity
+             << " bytes, current " << eHead << " at " << eBase
+             << ", last upload " << uploadBytes << " bytes" << endl;
+    }
+    cout << "  Cached VAOs: " << vaos.size() << endl;
+    if( cached ) {
+        cout << "  Content hash: " << hex << contentHash << dec
+             << ", shared by " << sharedUsers( vbuffer ) << endl;
+    }
+    cout << "  Canvas memory: live " << canvasMemory.live << " capacity "
+         << canvasMemory.capacity << " snapshots " << canvasMemory.snapshots
+         << " peak " << canvasMemory.peak << endl;
+}
+
+///
+/// setLayout(layout) - choose the vertex data layout to be used
+///     by subsequent createBuffers() calls
+///
+/// @param l   the desired layout
+///
+/// @return the old layout
+///
+VertexLayout BufferSet::setLayout( VertexLayout l ) {
+    VertexLayout old = layout;
+
+    layout = l;
+    return( old );
+}
+
+///
+/// setDynamic(on,segments) - choose whether subsequent createBuffers()
+///     calls make dynamic buffers
+///
+/// @param on         true for dynamic buffers
+/// @param segments   number of ring segments for the vertex data
+///                   (1 updates the vertex data in place)
+///
+/// @return the old setting
+///
+bool BufferSet::setDynamic( bool on, int segments ) {
+    bool old = dynamic;
+
+    dynamic = on;
+    ringSegments = segments < 1 ? 1 : segments;
+    return( old );
 }
 
 ///
@@ -74,16 +286,276 @@ void BufferSet::dumpBuffer( const char *which ) {
 ///
 /// @return the ID of the new buffer
 ///
-GLuint BufferSet::makeBuffer( GLenum target, const void *data, GLsizei size ) {
+GLuint BufferSet::makeBuffer( GLenum target, const void *data, GLsizei size,
+                              GLenum usage ) {
     GLuint buffer;
 
-    glGenBuffers( 1, &buffer );
-    glBindBuffer( target, buffer );
-    glBufferData( target, size, data, GL_STATIC_DRAW );
+    backend->genBuffers( 1, &buffer );
+    backend->bindBuffer( target, buffer );
+    backend->bufferData( target, size, data, usage );
 
     return( buffer );
 }
 
+///
+/// vertexData(C,size) - get the interleaved vertex data from a Canvas
+///     and record its layout; VL_SEPARATE is treated as VL_INTERLEAVED
+///
+/// @param C      the Canvas holding the data
+/// @param size   where to return the data size (bytes)
+///
+/// @return the data
+///
+const GLvoid *BufferSet::vertexData( Canvas &C, GLsizeiptr &size ) {
+    if( layout == VL_COMPACT ) {
+        // the Canvas quantizes and interleaves the data for us
+        CompactFormat fmt;
+        const GLvoid *data = C.viewCompact( fmt );
+
+        packed = true;
+        stride = fmt.stride;
+        vSize = numVertices * 3 * sizeof(float);
+        cSize = fmt.color  < 0 ? 0 : numVertices * 4 * sizeof(GLubyte);
+        nSize = fmt.normal < 0 ? 0 : numVertices * 2 * sizeof(GLshort);
+        tSize = fmt.uv     < 0 ? 0 : numVertices * 2 * sizeof(GLushort);
+        cOffset = fmt.color  < 0 ? 0 : fmt.color;
+        nOffset = fmt.normal < 0 ? 0 : fmt.normal;
+        tOffset = fmt.uv     < 0 ? 0 : fmt.uv;
+        uvBias[0] = fmt.uvBias[0];
+        uvBias[1] = fmt.uvBias[1];
+        uvScale[0] = fmt.uvScale[0];
+        uvScale[1] = fmt.uvScale[1];
+
+        size = numVertices * stride;
+        return( data );
+    }
+
+    // the Canvas interleaves the data for us; it only includes
+    // attributes that were supplied for every vertex
+    Interleaving fmt;
+    const float *data = C.viewInterleaved( fmt ).data;
+
+    packed = false;
+    stride = fmt.stride * sizeof(float);
+    vSize = numVertices * 4 * sizeof(float);
+    cSize = fmt.color  < 0 ? 0 : numVertices * 4 * sizeof(float);
+    nSize = fmt.normal < 0 ? 0 : numVertices * 3 * sizeof(float);
+    tSize = fmt.uv     < 0 ? 0 : numVertices * 2 * sizeof(float);
+    cOffset = fmt.color  < 0 ? 0 : fmt.color  * sizeof(float);
+    nOffset = fmt.normal < 0 ? 0 : fmt.normal * sizeof(float);
+    tOffset = fmt.uv     < 0 ? 0 : fmt.uv     * sizeof(float);
+
+    size = numVertices * stride;
+    return( data );
+}
+
+///
+/// canMapRange() - can we use glMapBufferRange()?
+///
+static bool canMapRange( void ) {
+    return( backend->hasCapability( CAP_MAP_BUFFER_RANGE ) );
+}
+
+///
+/// canUseVAOs() - can we use vertex array objects?
+///
+bool canUseVAOs( void ) {
+    return( backend->hasCapability( CAP_VERTEX_ARRAYS ) );
+}
+
+///
+/// dropVAOs() - delete all the cached vertex array objects, which
+///     refer to the buffers (and offsets) they were built with
+///
+void BufferSet::dropVAOs( void ) {
+    for( size_t i = 0; i < vaos.size(); ++i ) {
+        backend->deleteVertexArrays( 1, &(vaos[i].vao) );
+    }
+    vaos.clear();
+}
+
+///
+/// writeRange(target,offset,data,size) - write data into a range of
+///     the bound buffer that the GPU is known not to be using
+///
+/// The range is mapped without synchronization, so the write never
+/// waits for the GPU; glBufferSubData() is the fallback.
+///
+/// @param target   which buffer binding to write to
+/// @param offset   where in the buffer to write (bytes)
+/// @param data     the data to write
+/// @param size     how much to write (bytes)
+///
+void BufferSet::writeRange( GLenum target, GLintptr offset,
+                            const GLvoid *data, GLsizeiptr size ) {
+    if( size < 1 ) {
+        return;
+    }
+
+    if( canMapRange() ) {
+        void *dst = backend->mapBufferRange( target, offset, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+            GL_MAP_UNSYNCHRONIZED_BIT );
+        if( dst != NULL ) {
+            memcpy( dst, data, size );
+            // GL_FALSE means the contents were lost while mapped
+            if( backend->unmapBuffer( target ) == GL_TRUE ) {
+                return;
+            }
+        }
+    }
+
+    backend->bufferSubData( target, offset, size, data );
+}
+
+///
+/// updateRange(target,offset,last,data,size) - update a range of the
+///     bound buffer in place, sending only the bytes that changed
+///
+/// @param target   which buffer binding to write to
+/// @param offset   where the range begins in the buffer (bytes)
+/// @param last     what the range held; updated to the new data
+/// @param data     the new data
+/// @param size     the size of the new data (bytes)
+///
+/// @return the number of bytes sent
+///
+static GLsizeiptr updateRange( GLenum target, GLintptr offset,
+                               vector<unsigned char> &last,
+                               const GLvoid *data, GLsizeiptr size ) {
+    const unsigned char *d = (const unsigned char *) data;
+    GLsizeiptr first = 0, end = size;
+
+    // find the changed bytes (all of them, if the size changed)
+    if( (size_t) size == last.size() ) {
+        while( first < size && d[first] == last[first] ) {
+            first++;
+        }
+        while( end > first && d[end - 1] == last[end - 1] ) {
+            end--;
+        }
+    }
+
+    if( end > first ) {
+        backend->bufferSubData( target, offset + first, end - first, d + first );
+    }
+    last.assign( d, d + size );
+
+    return( end - first );
+}
+
+///
+/// updateBuffers(canvas) - update the buffers from the object now held
+///     in 'canvas', without reallocating them if possible
+///
+/// @param C     the Canvas we'll use for drawing
+///
+void BufferSet::updateBuffers( Canvas &C ) {
+
+    // static buffers are simply recreated
+    if( !dynamic || !bufferInit ) {
+        createBuffers( C );
+        return;
+    }
+
+    // as in createBuffers(), leave any vertex array object alone
+    if( canUseVAOs() ) {
+        backend->bindVertexArray( 0 );
+    }
+
+    numElements = C.numIndices();
+    numVertices = C.numVertices();
+    if( numElements < 1 ) {
+        createBuffers( C );
+        return;
+    }
+
+    const GLvoid *elements = C.viewElements();
+    GLenum type = C.elementType();
+    long size = numElements * (type == GL_UNSIGNED_SHORT ?
+                               sizeof(GLushort) : sizeof(GLuint));
+    // the attributes present, and where they are within each vertex,
+    // may change with the data; the cached vertex array objects were
+    // built for the old arrangement
+    GLsizei oldStride = stride;
+    bool oldPacked = packed;
+    long oldOffsets[3] = { cSize > 0 ? cOffset : -1, nSize > 0 ? nOffset : -1,
+                           tSize > 0 ? tOffset : -1 };
+
+    GLsizeiptr vbytes;
+    const GLvoid *data = vertexData( C, vbytes );
+
+    // if the data has outgrown the buffers, start over
+    if( size > eCapacity || vbytes > segSize ) {
+        createBuffers( C );
+        return;
+    }
+
+    if( stride != oldStride || packed != oldPacked ||
+        oldOffsets[0] != (cSize > 0 ? cOffset : -1) ||
+        oldOffsets[1] != (nSize > 0 ? nOffset : -1) ||
+        oldOffsets[2] != (tSize > 0 ? tOffset : -1) ) {
+        dropVAOs();
+    }
+    elemType = type;
+    eSize = size;
+    uploadBytes = 0;
+
+    // the connectivity changes rarely, but when it does it goes into
+    // the next segment of its own ring, for the same reason as the
+    // vertex data below
+    if( (size_t) eSize != lastElems.size() ||
+        memcmp( elements, lastElems.data(), eSize ) != 0 ) {
+        backend->bindBuffer( GL_ELEMENT_ARRAY_BUFFER, ebuffer );
+        eHead = (eHead + 1) % ringSegments;
+        if( eHead == 0 ) {
+            backend->bufferData( GL_ELEMENT_ARRAY_BUFFER,
+                          eCapacity * ringSegments, NULL, GL_DYNAMIC_DRAW );
+        }
+        eBase = eHead * eCapacity;
+
+        writeRange( GL_ELEMENT_ARRAY_BUFFER, eBase, elements, eSize );
+
+        const unsigned char *e = (const unsigned char *) elements;
+        lastElems.assign( e, e + eSize );
+        uploadBytes += eSize;
+    }
+
+    backend->bindBuffer( GL_ARRAY_BUFFER, vbuffer );
+
+    if( ringSegments == 1 ) {
+        // no ring; send just what changed
+        uploadBytes += updateRange( GL_ARRAY_BUFFER, 0, lastVerts,
+                                    data, vbytes );
+        return;
+    }
+
+    // nothing to do if the vertex data hasn't changed
+    if( (size_t) vbytes == lastVerts.size() &&
+        memcmp( data, lastVerts.data(), vbytes ) == 0 ) {
+        return;
+    }
+
+    // otherwise, it goes into the next segment of the ring, which
+    // the GPU can't still be reading:  when the ring wraps around,
+    // the whole buffer is orphaned, so the driver hands us fresh
+    // storage rather than waiting for earlier draws to finish
+    ringHead = (ringHead + 1) % ringSegments;
+    if( ringHead == 0 ) {
+        backend->bufferData( GL_ARRAY_BUFFER, segSize * ringSegments, NULL,
+                      GL_STREAM_DRAW );
+    }
+    ringBase = ringHead * segSize;
+
+    // selectBuffers() keeps a vertex array object for each segment,
+    // so the ones pointing at the others are simply left for later
+    writeRange( GL_ARRAY_BUFFER, ringBase, data, vbytes );
+
+    const unsigned char *v = (const unsigned char *) data;
+    lastVerts.assign( v, v + vbytes );
+    uploadBytes += vbytes;
+}
+
 ///
 /// createBuffers(canvas) create a set of buffers for the object
 ///     currently held in 'canvas'.
@@ -92,11 +564,23 @@ GLuint BufferSet::makeBuffer( GLenum target, const void *data, GLsizei size ) {
 ///
 void BufferSet::createBuffers( Canvas &C ) {
 
+    // buffer bindings are part of the state of a vertex array
+    // object, so make sure we don't disturb one of them
+    if( canUseVAOs() ) {
+        backend->bindVertexArray( 0 );
+    }
+
     // reset this BufferSet if it has already been used
     if( bufferInit ) {
-        // must delete the existing buffer IDs first
-        glDeleteBuffers( 1, &(vbuffer) );
-        glDeleteBuffers( 1, &(ebuffer) );
+        // must delete the existing buffer IDs first, along with
+        // the vertex array objects that use them
+        dropVAOs();
+        if( cached ) {
+            releaseShared( vbuffer, ebuffer );
+        } else {
+            backend->deleteBuffers( 1, &(vbuffer) );
+            backend->deleteBuffers( 1, &(ebuffer) );
+        }
         // clear everything out
         initBuffer();
     }
@@ -108,64 +592,157 @@ void BufferSet::createBuffers( Canvas &C ) {
     // other fields may or may not be present; this depends on
     // how the shape was created
     //
+    // with the separate layout:
+    //
     //             data        components   offset to beginning
     //          [ locations ]  XYZW         0
     //          [ colors    ]  RGBA         vSize
     //          [ normals   ]  XYZ          vSize+cSize
     //          [ t. coords ]  UV           vSize+cSize+nSize
+    //
+    // with the interleaved layout, each vertex holds the same
+    // fields in the same order, and the offsets are within the
+    // vertex:
+    //
+    //          [ XYZW RGBA XYZ UV ] [ XYZW RGBA XYZ UV ] ...
+    //
+    // the compact layout is interleaved too, but holds XYZ floats,
+    // RGBA bytes, an octahedral normal in two shorts, and UV as two
+    // unsigned shorts (see CompactFormat in Canvas.h)
     ///
 
-    // get the vertex count
-    numElements = C.numVertices();
+    // get the element and vertex counts; these differ if the
+    // Canvas has welded duplicate vertices together
+    numElements = C.numIndices();
+    numVertices = C.numVertices();
 
     // if there are no vertices, there's nothing for us to do
     if( numElements < 1 ) {
         return;
     }
 
-    // OK, we have vertices!
-    float *points = C.getVertices();
-    // #bytes = number of elements * 4 floats/element * bytes/float
-    vSize = numElements * 4 * sizeof(float);
+    // OK, we have vertices!  we upload straight from the Canvas'
+    // own storage rather than from get*() copies
+    const float *points = C.viewVertices().data;
+    // #bytes = number of vertices * 4 floats/vertex * bytes/float
+    vSize = numVertices * 4 * sizeof(float);
 
     // accumulate the total vertex buffer size
     GLsizeiptr vbufSize = vSize;
 
     // get the color data (if there is any)
-    float *colors = C.getColors();
+    const float *colors = C.viewColors().data;
     if( colors != NULL ) {
-        cSize = numElements * 4 * sizeof(float);
+        cSize = numVertices * 4 * sizeof(float);
         vbufSize += cSize;
     }
 
     // get the normal data (if there is any)
-    float *normals = C.getNormals();
+    const float *normals = C.viewNormals().data;
     if( normals != NULL ) {
-        nSize = numElements * 3 * sizeof(float);
+        nSize = numVertices * 3 * sizeof(float);
         vbufSize += nSize;
     }
 
     // get the (u,v) data (if there is any)
-    float *uv = C.getUV();
+    const float *uv = C.viewUV().data;
     if( uv != NULL ) {
-        tSize = numElements * 2 * sizeof(float);
+        tSize = numVertices * 2 * sizeof(float);
         vbufSize += tSize;
     }
 
     // get the element data
-    GLuint *elements = C.getElements();
+    const GLvoid *elements = C.viewElements();
+    elemType = C.elementType();
     // #bytes = number of elements * bytes/element
-    eSize = numElements * sizeof(GLuint);
+    eSize = numElements * (elemType == GL_UNSIGNED_SHORT ?
+                           sizeof(GLushort) : sizeof(GLuint));
+
+    if( dynamic ) {
+        // dynamic buffers are always interleaved, so that each
+        // update is a single contiguous range
+        GLsizeiptr size;
+        const GLvoid *data = vertexData( C, size );
+
+        // leave room to grow, so that updates rarely need new storage
+        eCapacity = (eSize + eSize / 4 + 3) & ~(GLsizeiptr) 3;
+        segSize = (size + size / 4 + 255) & ~(GLsizeiptr) 255;
+
+        ebuffer = makeBuffer( GL_ELEMENT_ARRAY_BUFFER, NULL,
+                              eCapacity * ringSegments, GL_DYNAMIC_DRAW );
+        writeRange( GL_ELEMENT_ARRAY_BUFFER, 0, elements, eSize );
+
+        vbuffer = makeBuffer( GL_ARRAY_BUFFER, NULL, segSize * ringSegments,
+                              GL_STREAM_DRAW );
+        writeRange( GL_ARRAY_BUFFER, 0, data, size );
+
+        const unsigned char *e = (const unsigned char *) elements;
+        const unsigned char *v = (const unsigned char *) data;
+        lastElems.assign( e, e + eSize );
+        lastVerts.assign( v, v + size );
+        uploadBytes = eSize + size;
+
+        canvasMemory = C.memoryReport();
+        bufferInit = true;
+        return;
+    }
+
+    // the Canvas interleaves (and perhaps quantizes) the data for
+    // us, so it takes just one copy, straight into the vertex buffer;
+    // with separate arrays, each section is tightly packed, and begins
+    // where the previous one ended
+    const GLvoid *data = NULL;
+    if( layout != VL_SEPARATE ) {
+        data = vertexData( C, vbufSize );
+    } else {
+        stride = 0;
+        cOffset = vSize;
+        nOffset = cOffset + cSize;
+        tOffset = nOffset + nSize;
+    }
+
+    // if some BufferSet already holds exactly this data, share its
+    // buffers rather than uploading another copy; the pieces are
+    // hashed where they lie, in the order they would be uploaded
+    long desc[SHARED_DESC] = { layout, (long) elemType, stride, vSize,
+                               cSize, nSize, tSize, cOffset, nOffset,
+                               tOffset };
+    contentHash = hashBytes( FNV_BASIS, desc, sizeof(desc) );
+    contentHash = hashBytes( contentHash, elements, eSize );
+    if( data != NULL ) {
+        contentHash = hashBytes( contentHash, data, vbufSize );
+    } else {
+        contentHash = hashBytes( contentHash, points, vSize );
+        contentHash = hashBytes( contentHash, colors, cSize );
+        contentHash = hashBytes( contentHash, normals, nSize );
+        contentHash = hashBytes( contentHash, uv, tSize );
+    }
+    cached = true;
+
+    if( shareBuffers( contentHash, desc, vbuffer, ebuffer ) ) {
+        canvasMemory = C.memoryReport();
+        bufferInit = true;
+        return;
+    }
 
     // first, create the connectivity data
     ebuffer = makeBuffer( GL_ELEMENT_ARRAY_BUFFER, elements, eSize );
 
+    if( data != NULL ) {
+        vbuffer = makeBuffer( GL_ARRAY_BUFFER, data, vbufSize );
+        addShared( contentHash, desc, vbuffer, ebuffer );
+
+        canvasMemory = C.memoryReport();
+        bufferInit = true;
+        return;
+    }
+
     // next, the vertex buffer, containing vertices and "extra" data
     // note that we use glBufferSubData() calls to do the copying
     vbuffer = makeBuffer( GL_ARRAY_BUFFER, NULL, vbufSize );
 
     // copy in the location data
-    glBufferSubData( GL_ARRAY_BUFFER, 0, vSize, points );
+    backend->bufferSubData( GL_ARRAY_BUFFER, 0, vSize, points );
 
     // offsets to subsequent sections are the sum of
     // the preceding section sizes (in bytes)
@@ -173,19 +750,19 @@ void BufferSet::createBuffers( Canvas &C ) {
 
     // add in the color data (if there is any)
     if( cSize > 0 ) {
-        glBufferSubData( GL_ARRAY_BUFFER, offset, cSize, colors );
+        backend->bufferSubData( GL_ARRAY_BUFFER, offset, cSize, colors );
         offset += cSize;
     }
 
     // add in the normal data (if there is any)
     if( nSize > 0 ) {
-        glBufferSubData( GL_ARRAY_BUFFER, offset, nSize, normals );
+        backend->bufferSubData( GL_ARRAY_BUFFER, offset, nSize, normals );
         offset += nSize;
     }
 
     // add in the (u,v) data (if there is any)
     if( tSize > 0 ) {
-        glBufferSubData( GL_ARRAY_BUFFER, offset, tSize, uv );
+        backend->bufferSubData( GL_ARRAY_BUFFER, offset, tSize, uv );
         offset += tSize;
     }
 
@@ -195,11 +772,14 @@ void BufferSet::createBuffers( Canvas &C ) {
             << offset << " vbufSize " << vbufSize << endl;
     }
 
-    // NOTE:  'points', 'colors', and 'elements' are dynamically allocated,
-    // but we don't free them here because they will be freed at the next
-    // call to clear() or the get*() functions
+    // NOTE:  all of the uploaded arrays belong to the Canvas itself,
+    // so there is nothing for us to free here
+
+    // other BufferSets may now share these
+    addShared( contentHash, desc, vbuffer, ebuffer );
 
-    // finally, mark it as set up
+    // finally, note the Canvas' memory use and mark it as set up
+    canvasMemory = C.memoryReport();
     bufferInit = true;
 }
 
@@ -215,53 +795,153 @@ void BufferSet::createBuffers( Canvas &C ) {
 void BufferSet::selectBuffers( GLuint program,
     const char *vp, const char *vc, const char *vn, const char *vt ) {
 
+    // if we've done this before, a vertex array object holds
+    // all the bindings, and binding it is all there is to do
+    if( vaoSupport < 0 ) {
+        vaoSupport = canUseVAOs();
+    }
+    if( vaoSupport ) {
+        // those built for a program that has since been released may
+        // match a new one given its name; rather than keep track of
+        // which, start again
+        if( vaoReleased != programsReleased() ) {
+            dropVAOs();
+            vaoReleased = programsReleased();
+        }
+
+        for( size_t i = 0; i < vaos.size(); ++i ) {
+            const VAOEntry &e = vaos[i];
+            if( e.program == program && e.segment == ringHead &&
+                e.vp == vp && e.vc == vc && e.vn == vn && e.vt == vt ) {
+                backend->bindVertexArray( e.vao );
+                return;
+            }
+        }
+
+        // first time; the set-up below is recorded in a new one
+        VAOEntry entry;
+        entry.program = program;
+        entry.vp = vp;
+        entry.vc = vc;
+        entry.vn = vn;
+        entry.vt = vt;
+        entry.segment = ringHead;
+        backend->genVertexArrays( 1, &(entry.vao) );
+        backend->bindVertexArray( entry.vao );
+        vaos.push_back( entry );
+    }
+
     // bind the buffers
-    glBindBuffer( GL_ARRAY_BUFFER, vbuffer );
-    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, ebuffer );
+    backend->bindBuffer( GL_ARRAY_BUFFER, vbuffer );
+    backend->bindBuffer( GL_ELEMENT_ARRAY_BUFFER, ebuffer );
 
     // set up the vertex attribute variables
 
-    // we always want position data
-    GLint loc = getAttribLoc( program , vp );
-    if( loc >= 0 ) {
-        glEnableVertexAttribArray( loc );
-        glVertexAttribPointer( loc, 4, GL_FLOAT, GL_FALSE, 0,
-                               BUFFER_OFFSET(0) );
+    // we always want position data; packed positions have no W,
+    // which the attribute then supplies as 1
+    GLint loc = backend->getAttribLocation( program, vp );
+    if( loc < 0 ) {
+        cerr << "selectBuffers: program " << program
+             << " has no attribute '" << vp << "'" << endl;
+    } else {
+        backend->enableVertexAttribArray( loc );
+        backend->vertexAttribPointer( loc, packed ? 3 : 4, GL_FLOAT, GL_FALSE,
+                               stride, BUFFER_OFFSET(ringBase) );
     }
 
-    // cumulative byte offset for subsequent data sections
-    int offset = vSize;
+    // the other attributes are only hooked up if they're present;
+    // their offsets were determined when the buffers were created.
+    // Some shader variants don't use them all, so a missing one is
+    // not an error.
 
     // do we also want color?
-    if( vc != NULL ) {
-        loc = getAttribLoc( program, vc );
+    if( vc != NULL && cSize > 0 ) {
+        loc = backend->getAttribLocation( program, vc );
         if( loc >= 0 ) {
-            glEnableVertexAttribArray( loc );
-            glVertexAttribPointer( loc, 4, GL_FLOAT, GL_FALSE, 0,
-                                   BUFFER_OFFSET(offset) );
+            backend->enableVertexAttribArray( loc );
+            if( packed ) {
+                backend->vertexAttribPointer( loc, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                                       stride, BUFFER_OFFSET(ringBase + cOffset) );
+            } else {
+                backend->vertexAttribPointer( loc, 4, GL_FLOAT, GL_FALSE, stride,
+                                       BUFFER_OFFSET(ringBase + cOffset) );
+            }
         }
-        offset += cSize;
     }
 
     // how about a surface normal?
-    if( vn != NULL ) {
-        loc = getAttribLoc( program, vn );
+    if( vn != NULL && nSize > 0 ) {
+        loc = backend->getAttribLocation( program, vn );
         if( loc >= 0 ) {
-            glEnableVertexAttribArray( loc );
-            glVertexAttribPointer( loc, 3, GL_FLOAT, GL_FALSE, 0,
-                                   BUFFER_OFFSET(offset) );
+            backend->enableVertexAttribArray( loc );
+            if( packed ) {
+                backend->vertexAttribPointer( loc, 2, GL_SHORT, GL_TRUE,
+                                       stride, BUFFER_OFFSET(ringBase + nOffset) );
+            } else {
+                backend->vertexAttribPointer( loc, 3, GL_FLOAT, GL_FALSE, stride,
+                                       BUFFER_OFFSET(ringBase + nOffset) );
+            }
         }
-        offset += nSize;
     }
 
     // what about texture coordinates?
-    if( vt != NULL ) {
-        loc = getAttribLoc( program, vt );
+    if( vt != NULL && tSize > 0 ) {
+        loc = backend->getAttribLocation( program, vt );
         if( loc >= 0 ) {
-            glEnableVertexAttribArray( loc );
-            glVertexAttribPointer( loc, 2, GL_FLOAT, GL_FALSE, 0,
-                                   BUFFER_OFFSET(offset) );
+            backend->enableVertexAttribArray( loc );
+            if( packed ) {
+                backend->vertexAttribPointer( loc, 2, GL_UNSIGNED_SHORT, GL_TRUE,
+                                       stride, BUFFER_OFFSET(ringBase + tOffset) );
+            } else {
+                backend->vertexAttribPointer( loc, 2, GL_FLOAT, GL_FALSE, stride,
+                                       BUFFER_OFFSET(ringBase + tOffset) );
+            }
         }
-        offset += tSize;
     }
 }
+
+///
+/// selectDecoding() - send the uniforms the vertex shader needs to
+///     decode this BufferSet's attributes
+///
+/// @param program   GLSL program object
+/// @param pn        name of the bool "normals are packed" uniform
+/// @param uvx       name of the vec4 (u,v) transform uniform
+///                  (scale in xy, bias in zw)
+///
+/// If the program uses uniform blocks, the values go into the current
+/// object's block instead, and the names aren't used.
+///
+void BufferSet::selectDecoding( GLuint program,
+    const char *pn, const char *uvx ) {
+
+    GLfloat uv[4] = { uvScale[0], uvScale[1], uvBias[0], uvBias[1] };
+
+    // with uniform blocks, these are part of the current object's block
+    if( usesUniformBlocks( program ) ) {
+        ObjectBlock *ob = objectBlock();
+        ob->packedNormals = packed;
+        memcpy( ob->uvTransform, uv, sizeof(uv) );
+        return;
+    }
+
+    // look up the variables once per program (and set of names)
+    if( !checkProgram( &decodeProgram, program ) ||
+        pn != decodePn || uvx != decodeUvx ) {
+        packedNormalsU = uniformInt( program, pn );
+        uvTransformU = uniformVec4( program, uvx );
+        decodePn = pn;
+        decodeUvx = uvx;
+    }
+
+    sendInt( packedNormalsU, packed );
+    sendVec4( uvTransformU, uv );
+}
+
+///
+/// drawBuffers() - draw the object; selectBuffers() must be in effect
+///
+void BufferSet::drawBuffers( void ) {
+    backend->drawElements( GL_TRIANGLES, numElements, elemType,
+                           BUFFER_OFFSET(eBase) );
+}
@@ -23,6 +23,8 @@
 
 #include <GLFW/glfw3.h>
 
+#include <vector>
+
 using namespace std;
 
 #include "Canvas.h"
@@ -32,6 +34,24 @@ using namespace std;
 ///
 #define BUFFER_OFFSET(i)        ((GLvoid *)(((char *)0) + (i)))
 
+///
+/// canUseVAOs() - can we use vertex array objects?
+///
+bool canUseVAOs( void );
+
+///
+/// A vertex array object holding the attribute set-up for one
+/// shader program and set of attribute names.  The names are told
+/// apart by their addresses, not their contents, so that finding
+/// one costs no string work.
+///
+typedef struct st_vaoentry {
+    GLuint program;     /// the shader program
+    const char *vp, *vc, *vn, *vt;   /// the attribute names
+    int segment;        /// the ring segment its attributes point into
+    GLuint vao;         /// the vertex array object
+} VAOEntry;
+
 ///
 /// All the relevant information needed to keep
 /// track of vertex and element buffers
@@ -43,12 +63,91 @@ public:
     /// buffer handles
     GLuint vbuffer, ebuffer;
 
-    /// total number of vertices
+    /// total number of elements (indices) to draw
     int numElements;
 
+    /// number of vertices in the vertex buffer
+    int numVertices;
+
+    /// type of the element data (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT)
+    GLenum elemType;
+
     /// component sizes (bytes)
     long vSize, eSize, tSize, cSize, nSize;
 
+    /// how the vertex data is laid out in the vertex buffer
+    VertexLayout layout;
+
+    /// bytes from one vertex to the next (0 for separate arrays)
+    GLsizei stride;
+
+    /// byte offsets of the color, normal, and texture coord data
+    long cOffset, nOffset, tOffset;
+
+    /// are the attributes quantized (VL_COMPACT)?
+    bool packed;
+
+    /// decoding of quantized (u,v) data:  uv = uvBias + uvScale * stored
+    float uvBias[2], uvScale[2];
+
+    ///
+    /// dynamic (streaming) buffers
+    ///
+    /// The vertex buffer is a ring of segments, each able to hold a
+    /// whole copy of the (interleaved) vertex data.  Each update that
+    /// changes the data writes it into the next segment, which the GPU
+    /// can't be reading; when the ring wraps around, the buffer storage
+    /// is orphaned.  With only one segment, just the changed bytes of
+    /// the vertex data are sent, in place.
+    ///
+    /// The element buffer is a ring of the same number of segments,
+    /// which moves on only when the connectivity changes; draws must
+    /// use eBase as the offset of the element data.
+    ///
+
+    /// should createBuffers() make dynamic buffers?
+    bool dynamic;
+
+    /// number of segments in the vertex buffer ring
+    int ringSegments;
+
+    /// bytes per ring segment, and element buffer capacity
+    GLsizeiptr segSize, eCapacity;
+
+    /// the segment holding the current vertex data, and its offset
+    int ringHead;
+    GLintptr ringBase;
+
+    /// the segment holding the current element data, and its offset
+    int eHead;
+    GLintptr eBase;
+
+    /// what was last sent to the vertex and element buffers
+    vector<unsigned char> lastVerts, lastElems;
+
+    /// bytes sent by the most recent create or update
+    long uploadBytes;
+
+    /// vertex array objects built by selectBuffers(), one per ring
+    /// segment used; they're only deleted when the buffers are recreated
+    vector<VAOEntry> vaos;
+
+    /// can vertex array objects be used?  (-1 until selectBuffers()
+    /// first asks)
+    int vaoSupport;
+
+    /// programsReleased() when the vertex array objects were last
+    /// checked; any released program's name may have been reused
+    unsigned long vaoReleased;
+
+    /// static buffers are shared by all BufferSets holding the same
+    /// data; the hash of that data, and are the buffers shared?
+    unsigned long long contentHash;
+    bool cached;
+
+    /// memory held by the Canvas when these buffers were created
+    CanvasMemory canvasMemory;
+
     /// have these already been set up?
     bool bufferInit;
 
@@ -71,16 +170,70 @@ public:
     ///
     void dumpBuffer( const char *which );
 
+    ///
+    /// setLayout(layout) - choose the vertex data layout to be used
+    ///     by subsequent createBuffers() calls
+    ///
+    /// @param l   the desired layout
+    ///
+    /// @return the old layout
+    ///
+    VertexLayout setLayout( VertexLayout l );
+
+    ///
+    /// setDynamic(on,segments) - choose whether subsequent
+    ///     createBuffers() calls make dynamic buffers, which can be
+    ///     updated cheaply with updateBuffers()
+    ///
+    /// @param on         true for dynamic buffers
+    /// @param segments   number of ring segments for the vertex data
+    ///                   (1 updates the vertex data in place)
+    ///
+    /// @return the old setting
+    ///
+    bool setDynamic( bool on, int segments = 3 );
+
     ///
     /// makeBuffer(target,data,size) - make a vertex or element array buffer
     ///
     /// @param target   which type of buffer to create
     /// @param data     source of data for buffer (or NULL)
     /// @param size     desired length of buffer
+    /// @param usage    expected usage of the buffer
     ///
     /// @return the ID of the new buffer
     ///
-    GLuint makeBuffer( GLenum target, const void *data, GLsizei size );
+    GLuint makeBuffer( GLenum target, const void *data, GLsizei size,
+                       GLenum usage = GL_STATIC_DRAW );
+
+    ///
+    /// vertexData(C,size) - get the interleaved vertex data from a
+    ///     Canvas and record its layout; VL_SEPARATE is treated as
+    ///     VL_INTERLEAVED
+    ///
+    /// @param C      the Canvas holding the data
+    /// @param size   where to return the data size (bytes)
+    ///
+    /// @return the data
+    ///
+    const GLvoid *vertexData( Canvas &C, GLsizeiptr &size );
+
+    ///
+    /// writeRange(target,offset,data,size) - write data into a range
+    ///     of the bound buffer that the GPU is known not to be using
+    ///
+    /// @param target   which buffer binding to write to
+    /// @param offset   where in the buffer to write (bytes)
+    /// @param data     the data to write
+    /// @param size     how much to write (bytes)
+    ///
+    void writeRange( GLenum target, GLintptr offset,
+                     const GLvoid *data, GLsizeiptr size );
+
+    ///
+    /// dropVAOs() - delete all the cached vertex array objects
+    ///
+    void dropVAOs( void );
 
     ///
     /// createBuffers(canvas) - create a set of buffers for the object
@@ -90,9 +243,24 @@ public:
     ///
     void createBuffers( Canvas &C );
 
+    ///
+    /// updateBuffers(canvas) - update the buffers from the object now
+    ///     held in 'canvas'; dynamic buffers are reused if the object
+    ///     still fits, and other buffers are recreated
+    ///
+    /// @param C     the Canvas we'll use for drawing
+    ///
+    void updateBuffers( Canvas &C );
+
     ///
     /// selectBuffers() - bind the correct vertex and element buffers
     ///
+    /// The bindings are cached in a vertex array object (if available)
+    /// the first time for each program and set of names, so later
+    /// calls only need to bind that.  The names are recognized by
+    /// address, so each call should pass the same strings (e.g., the
+    /// same literals).
+    ///
     /// @param program   GLSL program object
     /// @param vp        name of the position attribute variable
     /// @param vc        name of the color attribute variable (or NULL)
@@ -102,6 +270,25 @@ public:
     void selectBuffers( GLuint program, const char *vp, const char * vc,
                         const char *vn, const char *vt );
 
+    ///
+    /// selectDecoding() - send the uniforms the vertex shader needs to
+    ///     decode this BufferSet's attributes
+    ///
+    /// The handles are looked up once for each program, and kept; as
+    /// with selectBuffers(), the names are recognized by address.
+    ///
+    /// @param program   GLSL program object
+    /// @param pn        name of the bool "normals are packed" uniform
+    /// @param uvx       name of the vec4 (u,v) transform uniform
+    ///                  (scale in xy, bias in zw)
+    ///
+    void selectDecoding( GLuint program, const char *pn, const char *uvx );
+
+    ///
+    /// drawBuffers() - draw the object; selectBuffers() must be in effect
+    ///
+    void drawBuffers( void );
+
 };
 
 #endif
@@ -34,14 +34,41 @@
 ///  sequence.
 ///
 
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
+#include <thread>
 
 /// Canvas.h includes all the OpenGL/GLFW/etc. header files for us
 #include "Canvas.h"
 #include "Vector.h"
 
+///
+/// Memory accounting for vectors
+///
+template <typename T>
+static size_t bytes( const vector<T> &v )
+{
+    return( v.size() * sizeof(T) );
+}
+
+template <typename T>
+static size_t capacity( const vector<T> &v )
+{
+    return( v.capacity() * sizeof(T) );
+}
+
+///
+/// Free all of a vector's memory (clear() keeps its capacity)
+///
+template <typename T>
+static void release( vector<T> &v )
+{
+    vector<T>().swap( v );
+}
+
 ///
 /// Constructor
 ///
@@ -57,6 +84,11 @@ Canvas::Canvas( int w, int h ) : width(w), height(h) {
     uvArray = 0;
     elemArray = 0;
     numElements = 0;
+    pointBytes = normalBytes = uvBytes = colorBytes = elemBytes = 0;
+    peakBytes = 0;
+    shrinkOnClear = false;
+    indexed = false;
+    modified();
 }
 
 ///
@@ -75,6 +107,9 @@ Canvas::~Canvas( void ) {
 ///
 void Canvas::clear( void )
 {
+    // what we're about to free might be the most we've held
+    notePeak();
+
     if( pointArray ) {
         delete [] pointArray;
         pointArray = 0;
@@ -95,15 +130,115 @@ void Canvas::clear( void )
         delete [] colorArray;
         colorArray = 0;
     }
-    points.clear();
-    normals.clear();
-    uv.clear();
-    colors.clear();
+    pointBytes = normalBytes = uvBytes = colorBytes = elemBytes = 0;
+
+    // clear() on a vector keeps its capacity; swapping with an empty
+    // vector gives the memory back
+    if( shrinkOnClear ) {
+        release( points );
+        release( normals );
+        release( uv );
+        release( colors );
+    } else {
+        points.clear();
+        normals.clear();
+        uv.clear();
+        colors.clear();
+    }
     numElements = 0;
+
+    // the derived data can always go; it's rebuilt when needed
+    releaseDerived();
+    modified();
     currentColor = (Color) { 0.0f, 0.0f, 0.0f, 1.0f };
     currentDepth = -1.0f;
 }
 
+///
+/// Release memory that isn't in use
+///
+/// @return  The number of bytes released
+///
+size_t Canvas::shrink( void )
+{
+    notePeak();
+    size_t before = memoryReport().capacity;
+
+    points.shrink_to_fit();
+    normals.shrink_to_fit();
+    uv.shrink_to_fit();
+    colors.shrink_to_fit();
+    releaseDerived();
+    modified();
+
+    return( before - memoryReport().capacity );
+}
+
+///
+/// Choose whether clear() releases the Canvas' memory
+///
+/// @param on  true to release memory on clear()
+/// @return    The old setting
+///
+bool Canvas::setShrinkOnClear( bool on )
+{
+    bool old = shrinkOnClear;
+
+    shrinkOnClear = on;
+    return( old );
+}
+
+///
+/// Report the memory held by this Canvas
+///
+/// @return  The current usage and the high-water mark
+///
+CanvasMemory Canvas::memoryReport( void ) const
+{
+    CanvasMemory m;
+
+    m.live = bytes( points ) + bytes( normals ) + bytes( uv ) +
+             bytes( colors ) + bytes( wPoints ) + bytes( wNormals ) +
+             bytes( wUV ) + bytes( wColors ) + bytes( indices ) +
+             bytes( shortIndices ) + bytes( interleaved ) + bytes( compact );
+    m.capacity = capacity( points ) + capacity( normals ) +
+             capacity( uv ) + capacity( colors ) + capacity( wPoints ) +
+             capacity( wNormals ) + capacity( wUV ) + capacity( wColors ) +
+             capacity( indices ) + capacity( shortIndices ) +
+             capacity( interleaved ) + capacity( compact );
+    m.snapshots = pointBytes + normalBytes + uvBytes + colorBytes + elemBytes;
+
+    if( m.capacity + m.snapshots > peakBytes ) {
+        peakBytes = m.capacity + m.snapshots;
+    }
+    m.peak = peakBytes;
+
+    return( m );
+}
+
+///
+/// Update the memory high-water mark
+///
+void Canvas::notePeak( void ) const
+{
+    (void) memoryReport();
+}
+
+///
+/// Free all the derived (welded, interleaved, compact) data
+///
+void Canvas::releaseDerived( void )
+{
+    release( wPoints );
+    release( wNormals );
+    release( wUV );
+    release( wColors );
+    release( indices );
+    release( shortIndices );
+    release( interleaved );
+    release( compact );
+}
+
 ///
 /// Set the pixel Z coordinate
 ///
@@ -132,6 +267,32 @@ Color Canvas::setColor( Color color )
     return( old );
 }
 
+///
+/// Note that the Canvas contents have changed, so that any derived
+/// data must be rebuilt when next retrieved
+///
+void Canvas::modified( void )
+{
+    weldStale = true;
+    interleaveStale = true;
+    compactStale = true;
+}
+
+///
+/// Select indexed output
+///
+/// @param on  true for indexed output, false for one vertex per element
+/// @return    The old setting
+///
+bool Canvas::setIndexed( bool on )
+{
+    bool old = indexed;
+
+    indexed = on;
+    modified();
+    return( old );
+}
+
     /////////////////////////////////////
     //
     // Adding things to the Canvas
@@ -190,6 +351,7 @@ void Canvas::addColor( Color c )
     colors.push_back( c.g );
     colors.push_back( c.b );
     colors.push_back( c.a );
+    modified();
 }
 
 ///
@@ -207,6 +369,7 @@ void Canvas::addVertex( Vertex v )
     // here is where we actually count the number of
     // things that have been put into the canvas
     numElements += 1;
+    modified();
 }
 
 ///
@@ -219,6 +382,7 @@ void Canvas::addNormal( Normal n )
     normals.push_back( n.x );
     normals.push_back( n.y );
     normals.push_back( n.z );
+    modified();
 }
 
 ///
@@ -230,6 +394,7 @@ void Canvas::addTexCoord( TexCoord t )
 {
     uv.push_back( t.u );
     uv.push_back( t.v );
+    modified();
 }
 
     /////////////////////////////////////
@@ -239,7 +404,7 @@ void Canvas::addTexCoord( TexCoord t )
 ///
 /// Add a triangle to the current shape
 ///
-/// Calculates a triangle-wide surface normal and adds that as well
+/// Calculates a triangle-wide unit surface normal and adds that as well
 ///
 /// @param p0 first triangle vertex
 /// @param p1 second triangle vertex
@@ -247,15 +412,10 @@ void Canvas::addTexCoord( TexCoord t )
 ///
 void Canvas::addTriangle( Vertex p0, Vertex p1, Vertex p2 )
 {
-    // calculate the normal for the triangle
-    Vector u = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
-    Vector v = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
-    Vector n;
+    Vertex p[3] = { p0, p1, p2 };
 
-    cross( n, u, v );
-    Normal nn = { n[VX], n[VY], n[VZ] };
-
-    addTriangleWithNorms( p0, nn, p1, nn, p2, nn );
+    // a batch of one; the normal is calculated for us
+    addTriangles( 1, p, 0, NULL, 0, NULL, 0 );
 }
 
 ///
@@ -290,12 +450,783 @@ void Canvas::addTextureCoords( TexCoord uv0, TexCoord uv1, TexCoord uv2 )
     addTexCoord( uv2 );
 }
 
+///
+/// Make room for more vertices
+///
+/// @param nVerts  The number of vertices about to be added
+/// @param attrs   Which other attributes they will have
+///
+void Canvas::reserve( int nVerts, int attrs )
+{
+    points.reserve( points.size() + nVerts * 4 );
+    if( attrs & CA_NORMALS ) {
+        normals.reserve( normals.size() + nVerts * 3 );
+    }
+    if( attrs & CA_UV ) {
+        uv.reserve( uv.size() + nVerts * 2 );
+    }
+    if( attrs & CA_COLORS ) {
+        colors.reserve( colors.size() + nVerts * 4 );
+    }
+}
+
+///
+/// Copy strided records into a float vector
+///
+/// @param dst      The vector to append to
+/// @param src      The first record
+/// @param stride   Bytes between records (0 if tightly packed)
+/// @param n        The number of records
+/// @param size     The number of floats per record
+///
+static void appendStrided( vector<float> &dst, const void *src,
+                           size_t stride, int n, int size )
+{
+    size_t at = dst.size();
+    size_t bytes = size * sizeof(float);
+
+    dst.resize( at + n * size );
+    float *out = dst.data() + at;
+
+    if( stride == 0 || stride == bytes ) {
+        // already laid out the way we keep it
+        memcpy( out, src, n * bytes );
+        return;
+    }
+
+    const char *in = (const char *) src;
+    for( int i = 0; i < n; i++, in += stride, out += size ) {
+        memcpy( out, in, bytes );
+    }
+}
+
+///
+/// Add a batch of triangles to the current shape
+///
+/// @param count       number of triangles
+/// @param pos         vertex positions (W is ignored)
+/// @param posStride   stride of the positions
+/// @param norm        vertex normals (or NULL for each
+///                    triangle's unit face normal)
+/// @param normStride  stride of the normals
+/// @param tex         vertex (u,v) data (or NULL)
+/// @param uvStride    stride of the (u,v) data
+///
+void Canvas::addTriangles( int count, const Vertex *pos, size_t posStride,
+                           const Normal *norm, size_t normStride,
+                           const TexCoord *tex, size_t uvStride )
+{
+    int n = count * 3;
+
+    if( n < 1 ) {
+        return;
+    }
+
+    // positions always get W = 1, so they can't be copied wholesale
+    if( posStride == 0 ) {
+        posStride = sizeof(Vertex);
+    }
+    size_t at = points.size();
+    points.resize( at + n * 4 );
+    float *out = points.data() + at;
+    const char *in = (const char *) pos;
+    for( int i = 0; i < n; i++, in += posStride, out += 4 ) {
+        memcpy( out, in, 3 * sizeof(float) );
+        out[3] = 1.0f;
+    }
+
+    if( norm != NULL ) {
+        appendStrided( normals, norm, normStride, n, 3 );
+    } else {
+        // flat shading:  compute all the face normals in one batch,
+        // from the positions we just stored, and give each vertex
+        // its triangle's normal
+        vector<float> face( count * 3 );
+        faceNormals( face.data(), points.data() + at, 4 * sizeof(float),
+                     count );
+
+        size_t nat = normals.size();
+        normals.resize( nat + n * 3 );
+        float *nout = normals.data() + nat;
+        for( int t = 0; t < count; t++ ) {
+            for( int k = 0; k < 3; k++, nout += 3 ) {
+                memcpy( nout, &face[t*3], 3 * sizeof(float) );
+            }
+        }
+    }
+    if( tex != NULL ) {
+        appendStrided( uv, tex, uvStride, n, 2 );
+    }
+
+    numElements += n;
+    modified();
+}
+
+///
+/// Append the contents of another Canvas to this one
+///
+/// @param src  The Canvas to copy from
+/// @return     true if the contents were appended
+///
+bool Canvas::append( const Canvas &src )
+{
+    // each attribute must be present in both, or in neither
+    if( numElements > 0 && src.numElements > 0 &&
+        (normals.empty() != src.normals.empty() ||
+         uv.empty() != src.uv.empty() ||
+         colors.empty() != src.colors.empty()) ) {
+        cerr << "append: the Canvases have different attributes" << endl;
+        return( false );
+    }
+
+    points.insert( points.end(), src.points.begin(), src.points.end() );
+    normals.insert( normals.end(), src.normals.begin(), src.normals.end() );
+    uv.insert( uv.end(), src.uv.begin(), src.uv.end() );
+    colors.insert( colors.end(), src.colors.begin(), src.colors.end() );
+
+    numElements += src.numElements;
+    modified();
+
+    return( true );
+}
+
+    /////////////////////////////////////
+    // Derived data
+    /////////////////////////////////////
+
+///
+/// Run body(first,last) over [0,n), split into ranges that are run
+/// on separate threads.  Small jobs aren't worth a thread, so each
+/// thread gets at least 'grain' items.
+///
+/// @param n      The number of items
+/// @param grain  The fewest items worth giving a thread
+/// @param body   What to do with a range of items
+///
+template <typename Body>
+static void parallelRanges( int n, int grain, Body body )
+{
+    int nThreads = thread::hardware_concurrency();
+    if( nThreads < 1 ) {
+        nThreads = 1;
+    }
+    if( nThreads > n / grain ) {
+        nThreads = n / grain;
+    }
+    if( nThreads <= 1 ) {
+        body( 0, n );
+        return;
+    }
+
+    vector<thread> workers;
+    int chunk = (n + nThreads - 1) / nThreads;
+    for( int first = 0; first < n; first += chunk ) {
+        int last = first + chunk < n ? first + chunk : n;
+        workers.push_back( thread( body, first, last ) );
+    }
+    for( size_t i = 0; i < workers.size(); i++ ) {
+        workers[i].join();
+    }
+}
+
+///
+/// Replace the normals of the current shape with smooth vertex normals
+///
+/// @param creaseAngle    The crease angle, in degrees
+/// @param weldTolerance  How close positions must be to be welded,
+///                       as a fraction of the shape's largest extent
+///
+void Canvas::computeSmoothNormals( float creaseAngle, float weldTolerance )
+{
+    int nTri = numElements / 3;
+    int n = nTri * 3;
+
+    if( n < 1 ) {
+        return;
+    }
+
+    const float *p = points.data();
+
+    // Step 1:  weld coincident positions.  Positions are snapped to a
+    // grid of cells weldTolerance times the size of the shape, and
+    // hashed.  A position within the tolerance of another lies in the
+    // same cell or a neighboring one, so those 27 cells are searched
+    // for an earlier position close enough to share a number with.
+    float lo[3] = { p[0], p[1], p[2] }, hi[3] = { p[0], p[1], p[2] };
+    for( int v = 1; v < n; v++ ) {
+        for( int k = 0; k < 3; k++ ) {
+            float c = p[v*4+k];
+            lo[k] = c < lo[k] ? c : lo[k];
+            hi[k] = c > hi[k] ? c : hi[k];
+        }
+    }
+    float extent = fmaxf( hi[0] - lo[0],
+                          fmaxf( hi[1] - lo[1], hi[2] - lo[2] ) );
+    if( !(weldTolerance > 0.0f) ) {
+        cerr << "computeSmoothNormals: bad weld tolerance "
+             << weldTolerance << ", using 1e-6" << endl;
+        weldTolerance = 1.0e-6f;
+    }
+    float cell = extent > 0.0f ? extent * weldTolerance : 1.0f;
+
+    size_t tableSize = 16;
+    while( tableSize < (size_t) n * 2 ) {
+        tableSize <<= 1;
+    }
+    vector<int> table( tableSize, -1 );   // a welded vertex in each cell
+    vector<int> next( n, -1 );            // the next one in the same cell
+    vector<long> key( n * 3 );            // grid coordinates of each vertex
+    vector<int> posOf( n );               // position number of each vertex
+    float tol2 = cell * cell;
+    int nPos = 0;
+
+    // the table slot for a cell:  either empty, or holding a vertex
+    // in that cell
+    auto findCell = [&]( long x, long y, long z ) {
+        unsigned int h = 2166136261u;
+        h = (h ^ (unsigned int) x) * 16777619u;
+        h = (h ^ (unsigned int) y) * 16777619u;
+        h = (h ^ (unsigned int) z) * 16777619u;
+        size_t slot = h & (tableSize - 1);
+        while( table[slot] >= 0 ) {
+            int u = table[slot];
+            if( key[u*3] == x && key[u*3+1] == y && key[u*3+2] == z ) {
+                break;
+            }
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        return( slot );
+    };
+
+    for( int v = 0; v < n; v++ ) {
+        for( int k = 0; k < 3; k++ ) {
+            key[v*3+k] = lrintf( (p[v*4+k] - lo[k]) / cell );
+        }
+        int match = -1;
+        for( int c = 0; c < 27 && match < 0; c++ ) {
+            size_t slot = findCell( key[v*3] + c % 3 - 1,
+                                    key[v*3+1] + c / 3 % 3 - 1,
+                                    key[v*3+2] + c / 9 - 1 );
+            for( int u = table[slot]; u >= 0 && match < 0; u = next[u] ) {
+                float dx = p[u*4] - p[v*4];
+                float dy = p[u*4+1] - p[v*4+1];
+                float dz = p[u*4+2] - p[v*4+2];
+                if( dx * dx + dy * dy + dz * dz <= tol2 ) {
+                    match = u;
+                }
+            }
+        }
+        if( match >= 0 ) {
+            posOf[v] = posOf[match];
+        } else {
+            size_t slot = findCell( key[v*3], key[v*3+1], key[v*3+2] );
+            next[v] = table[slot];
+            table[slot] = v;
+            posOf[v] = nPos++;
+        }
+    }
+
+    // Step 2:  unit face normals, and the angle at each corner, in
+    // parallel over ranges of triangles
+    vector<float> face( nTri * 3 );
+    vector<float> angle( n );
+    parallelRanges( nTri, 4096, [&]( int first, int last ) {
+        faceNormals( &face[first*3], p + first*12, 4 * sizeof(float),
+                     last - first );
+        for( int t = first; t < last; t++ ) {
+            for( int k = 0; k < 3; k++ ) {
+                const float *a = p + (t*3 + k) * 4;
+                const float *b = p + (t*3 + (k+1) % 3) * 4;
+                const float *c = p + (t*3 + (k+2) % 3) * 4;
+                Vector e1 = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+                Vector e2 = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+                norm( e1, e1 );
+                norm( e2, e2 );
+                float d = dot( e1, e2 );
+                d = d < -1.0f ? -1.0f : (d > 1.0f ? 1.0f : d);
+                angle[t*3+k] = acosf( d );
+            }
+        }
+    } );
+
+    // Step 3:  group the corners by position (a counting sort), so
+    // that each position's corners can be visited together
+    vector<int> start( nPos + 1, 0 );
+    for( int v = 0; v < n; v++ ) {
+        start[posOf[v] + 1]++;
+    }
+    for( int i = 0; i < nPos; i++ ) {
+        start[i+1] += start[i];
+    }
+    vector<int> corners( n );
+    vector<int> fill( start.begin(), start.end() - 1 );
+    for( int v = 0; v < n; v++ ) {
+        corners[fill[posOf[v]]++] = v;
+    }
+
+    // Step 4:  each corner's normal is the angle-weighted sum of the
+    // normals of the faces at its position that are within the crease
+    // angle of its own face; positions are independent, so they are
+    // done in parallel
+    float cosCrease = cosf( creaseAngle * (float) M_PI / 180.0f );
+    normals.resize( n * 3 );
+    float *out = normals.data();
+    parallelRanges( nPos, 1024, [&]( int first, int last ) {
+        for( int i = first; i < last; i++ ) {
+            for( int a = start[i]; a < start[i+1]; a++ ) {
+                int v = corners[a];
+                const float *fv = &face[(v / 3) * 3];
+                Vector sum = { 0.0f, 0.0f, 0.0f };
+                for( int b = start[i]; b < start[i+1]; b++ ) {
+                    int w = corners[b];
+                    const float *fw = &face[(w / 3) * 3];
+                    if( w == v || dot( fv, fw ) >= cosCrease ) {
+                        sum[VX] += angle[w] * fw[0];
+                        sum[VY] += angle[w] * fw[1];
+                        sum[VZ] += angle[w] * fw[2];
+                    }
+                }
+                norm( out + v*3, sum );
+            }
+        }
+    } );
+
+    modified();
+}
+
     /////////////////////////////////////
     //
     // Retrieving things from the Canvas
     //
     /////////////////////////////////////
 
+///
+/// Fold a run of floats into an FNV-1a hash, by bit pattern
+///
+/// @param h   The hash so far
+/// @param f   The floats to be added
+/// @param n   How many there are
+/// @return    The new hash value
+///
+static unsigned int hashFloats( unsigned int h, const float *f, int n )
+{
+    const unsigned char *b = (const unsigned char *) f;
+
+    for( size_t i = 0; i < n * sizeof(float); i++ ) {
+        h = (h ^ b[i]) * 16777619u;
+    }
+    return( h );
+}
+
+///
+/// Rebuild the welded and element data if it is out of date
+///
+/// In indexed mode, vertices are welded if all of their attributes
+/// are bitwise identical; an attribute only takes part if it was
+/// supplied for every vertex.  Otherwise, element i is just vertex i.
+///
+void Canvas::weld( void ) const
+{
+    if( !weldStale ) {
+        return;
+    }
+    weldStale = false;
+
+    int n = numElements;
+
+    wPoints.clear();
+    wNormals.clear();
+    wUV.clear();
+    wColors.clear();
+    indices.resize( n );
+    shortIndices.clear();
+
+    if( !indexed ) {
+        for( int i = 0; i < n; i++ ) {
+            indices[i] = i;
+        }
+        notePeak();
+        return;
+    }
+
+    bool hasN = (int) normals.size() >= n * 3;
+    bool hasT = (int) uv.size() >= n * 2;
+    bool hasC = (int) colors.size() >= n * 4;
+
+    // open-addressed table of welded vertex numbers (-1 if empty),
+    // kept at most half full
+    size_t tableSize = 16;
+    while( tableSize < (size_t) n * 2 ) {
+        tableSize <<= 1;
+    }
+    vector<int> table( tableSize, -1 );
+    int unique = 0;
+
+    for( int i = 0; i < n; i++ ) {
+        const float *p = &points[i*4];
+        const float *nn = hasN ? &normals[i*3] : NULL;
+        const float *t = hasT ? &uv[i*2] : NULL;
+        const float *c = hasC ? &colors[i*4] : NULL;
+
+        unsigned int h = hashFloats( 2166136261u, p, 4 );
+        if( hasN ) h = hashFloats( h, nn, 3 );
+        if( hasT ) h = hashFloats( h, t, 2 );
+        if( hasC ) h = hashFloats( h, c, 4 );
+
+        size_t slot = h & (tableSize - 1);
+        int found = -1;
+        while( table[slot] >= 0 ) {
+            int u = table[slot];
+            if( !memcmp( &wPoints[u*4], p, 4 * sizeof(float) ) &&
+                ( !hasN || !memcmp( &wNormals[u*3], nn, 3 * sizeof(float) ) ) &&
+                ( !hasT || !memcmp( &wUV[u*2], t, 2 * sizeof(float) ) ) &&
+                ( !hasC || !memcmp( &wColors[u*4], c, 4 * sizeof(float) ) ) ) {
+                found = u;
+                break;
+            }
+            slot = (slot + 1) & (tableSize - 1);
+        }
+
+        // first time we've seen this vertex?
+        if( found < 0 ) {
+            found = unique++;
+            table[slot] = found;
+            wPoints.insert( wPoints.end(), p, p + 4 );
+            if( hasN ) wNormals.insert( wNormals.end(), nn, nn + 3 );
+            if( hasT ) wUV.insert( wUV.end(), t, t + 2 );
+            if( hasC ) wColors.insert( wColors.end(), c, c + 4 );
+        }
+
+        indices[i] = found;
+    }
+
+    // use 16-bit indices when they fit
+    if( unique <= 65536 ) {
+        shortIndices.assign( indices.begin(), indices.end() );
+    }
+
+    notePeak();
+}
+
+///
+/// Make a view of one of the attribute vectors
+///
+/// @param v   The vector to view
+/// @return    A view of its contents
+///
+static AttribView makeView( const vector<float> &v )
+{
+    AttribView view = { v.empty() ? NULL : v.data(), (int) v.size() };
+
+    return( view );
+}
+
+///
+/// View the vertex data in this Canvas
+///
+/// @return A view of the data (XYZW per vertex)
+///
+AttribView Canvas::viewVertices( void ) const
+{
+    if( indexed ) {
+        weld();
+        return makeView( wPoints );
+    }
+    return makeView( points );
+}
+
+///
+/// View the normal data in this Canvas
+///
+/// @return A view of the data (XYZ per vertex)
+///
+AttribView Canvas::viewNormals( void ) const
+{
+    if( indexed ) {
+        weld();
+        return makeView( wNormals );
+    }
+    return makeView( normals );
+}
+
+///
+/// View the (u,v) data in this Canvas
+///
+/// @return A view of the data (UV per vertex)
+///
+AttribView Canvas::viewUV( void ) const
+{
+    if( indexed ) {
+        weld();
+        return makeView( wUV );
+    }
+    return makeView( uv );
+}
+
+///
+/// View the color data in this Canvas
+///
+/// @return A view of the data (RGBA per vertex)
+///
+AttribView Canvas::viewColors( void ) const
+{
+    if( indexed ) {
+        weld();
+        return makeView( wColors );
+    }
+    return makeView( colors );
+}
+
+///
+/// View all the vertex data in this Canvas, interleaved
+///
+/// @param fmt  Where to return the layout of each vertex
+/// @return     A view of the data (fmt.stride floats per vertex)
+///
+AttribView Canvas::viewInterleaved( Interleaving &fmt ) const
+{
+    if( interleaveStale ) {
+        interleaveStale = false;
+
+        AttribView p = viewVertices();
+        AttribView c = viewColors();
+        AttribView n = viewNormals();
+        AttribView t = viewUV();
+        int nv = p.length / 4;
+
+        // lay out whichever attributes cover every vertex
+        Interleaving &f = interleaving;
+        f.stride = 4;
+        f.position = 0;
+        f.color = f.normal = f.uv = -1;
+        if( c.data && c.length >= nv * 4 ) {
+            f.color = f.stride;
+            f.stride += 4;
+        }
+        if( n.data && n.length >= nv * 3 ) {
+            f.normal = f.stride;
+            f.stride += 3;
+        }
+        if( t.data && t.length >= nv * 2 ) {
+            f.uv = f.stride;
+            f.stride += 2;
+        }
+
+        interleaved.resize( nv * f.stride );
+        float *out = interleaved.data();
+        for( int i = 0; i < nv; i++, out += f.stride ) {
+            memcpy( out, p.data + i*4, 4 * sizeof(float) );
+            if( f.color >= 0 )
+                memcpy( out + f.color, c.data + i*4, 4 * sizeof(float) );
+            if( f.normal >= 0 )
+                memcpy( out + f.normal, n.data + i*3, 3 * sizeof(float) );
+            if( f.uv >= 0 )
+                memcpy( out + f.uv, t.data + i*2, 2 * sizeof(float) );
+        }
+        notePeak();
+    }
+
+    fmt = interleaving;
+    return makeView( interleaved );
+}
+
+///
+/// Quantize a value in [-1,1] to a normalized short
+///
+/// @param f   The value
+/// @return    Its nearest representable short
+///
+static GLshort toSnorm16( float f )
+{
+    f = f < -1.0f ? -1.0f : (f > 1.0f ? 1.0f : f);
+    return( (GLshort) lrintf( f * 32767.0f ) );
+}
+
+///
+/// Quantize a value in [0,1] to a normalized unsigned short
+///
+/// @param f   The value
+/// @return    Its nearest representable unsigned short
+///
+static GLushort toUnorm16( float f )
+{
+    // written so that a NaN becomes 0
+    f = !(f > 0.0f) ? 0.0f : (f > 1.0f ? 1.0f : f);
+    return( (GLushort) lrintf( f * 65535.0f ) );
+}
+
+///
+/// Quantize a value in [0,1] to a normalized unsigned byte
+///
+/// @param f   The value
+/// @return    Its nearest representable unsigned byte
+///
+static GLubyte toUnorm8( float f )
+{
+    f = f < 0.0f ? 0.0f : (f > 1.0f ? 1.0f : f);
+    return( (GLubyte) lrintf( f * 255.0f ) );
+}
+
+///
+/// Encode a normal vector using the octahedral mapping
+///
+/// The vector is projected onto the octahedron |x|+|y|+|z| = 1, and
+/// the lower half is folded over the upper half, leaving two values
+/// in [-1,1].  The shader reverses this (see octDecode() in
+/// texture.vert).
+///
+/// @param n    The normal (need not be unit length)
+/// @param out  Where to store the two encoded values
+///
+static void octEncode( const float *n, GLshort out[2] )
+{
+    float sum = fabsf( n[0] ) + fabsf( n[1] ) + fabsf( n[2] );
+
+    // a degenerate normal just points along +Z
+    if( sum == 0.0f ) {
+        out[0] = out[1] = 0;
+        return;
+    }
+
+    float x = n[0] / sum;
+    float y = n[1] / sum;
+
+    if( n[2] < 0.0f ) {
+        float fx = (1.0f - fabsf( y )) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - fabsf( x )) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+
+    out[0] = toSnorm16( x );
+    out[1] = toSnorm16( y );
+}
+
+///
+/// View all the vertex data in this Canvas, interleaved and quantized
+///
+/// @param fmt  Where to return the layout of each vertex
+/// @return     numVertices() vertices of fmt.stride bytes, or NULL
+///
+const GLvoid *Canvas::viewCompact( CompactFormat &fmt ) const
+{
+    if( compactStale ) {
+        compactStale = false;
+
+        AttribView p = viewVertices();
+        AttribView c = viewColors();
+        AttribView n = viewNormals();
+        AttribView t = viewUV();
+        int nv = p.length / 4;
+
+        // lay out whichever attributes cover every vertex
+        CompactFormat &f = compactFormat;
+        f.stride = 3 * sizeof(float);
+        f.position = 0;
+        f.color = f.normal = f.uv = -1;
+        if( c.data && c.length >= nv * 4 ) {
+            f.color = f.stride;
+            f.stride += 4 * sizeof(GLubyte);
+        }
+        if( n.data && n.length >= nv * 3 ) {
+            f.normal = f.stride;
+            f.stride += 2 * sizeof(GLshort);
+        }
+        f.uvBias[0] = f.uvBias[1] = 0.0f;
+        f.uvScale[0] = f.uvScale[1] = 1.0f;
+        if( t.data && t.length >= nv * 2 ) {
+            f.uv = f.stride;
+            f.stride += 2 * sizeof(GLushort);
+
+            // the stored values span the range of the whole mesh;
+            // values that aren't finite (e.g., the sphere's u at the
+            // poles) don't count, and are stored as 0
+            for( int k = 0; k < 2; k++ ) {
+                float lo = 0.0f, hi = 0.0f;
+                bool any = false;
+                for( int i = 0; i < nv; i++ ) {
+                    float u = t.data[i*2+k];
+                    if( !std::isfinite( u ) ) {
+                        continue;
+                    }
+                    lo = !any || u < lo ? u : lo;
+                    hi = !any || u > hi ? u : hi;
+                    any = true;
+                }
+                f.uvBias[k] = lo;
+                f.uvScale[k] = hi > lo ? hi - lo : 1.0f;
+
+                // a range too wide for a float can't be represented
+                if( !std::isfinite( f.uvScale[k] ) ) {
+                    cerr << "viewCompact: (u,v) range ["
+                         << lo << "," << hi << "] too wide" << endl;
+                    f.uvBias[k] = 0.0f;
+                    f.uvScale[k] = 1.0f;
+                }
+            }
+        }
+
+        compact.resize( nv * f.stride );
+        unsigned char *out = compact.data();
+        for( int i = 0; i < nv; i++, out += f.stride ) {
+            memcpy( out, p.data + i*4, 3 * sizeof(float) );
+            if( f.color >= 0 ) {
+                GLubyte *rgba = (GLubyte *) (out + f.color);
+                for( int k = 0; k < 4; k++ ) {
+                    rgba[k] = toUnorm8( c.data[i*4+k] );
+                }
+            }
+            if( f.normal >= 0 ) {
+                GLshort oct[2];
+                octEncode( n.data + i*3, oct );
+                memcpy( out + f.normal, oct, sizeof(oct) );
+            }
+            if( f.uv >= 0 ) {
+                GLushort st[2];
+                for( int k = 0; k < 2; k++ ) {
+                    float u = t.data[i*2+k];
+                    st[k] = std::isfinite( u ) ?
+                        toUnorm16( (u - f.uvBias[k]) / f.uvScale[k] ) : 0;
+                }
+                memcpy( out + f.uv, st, sizeof(st) );
+            }
+        }
+        notePeak();
+    }
+
+    fmt = compactFormat;
+    return( compact.empty() ? NULL : compact.data() );
+}
+
+///
+/// View the element data in this Canvas
+///
+/// @return A pointer to numIndices() indices of type elementType(),
+///         or NULL
+///
+const GLvoid *Canvas::viewElements( void ) const
+{
+    weld();
+
+    if( !shortIndices.empty() ) {
+        return shortIndices.data();
+    }
+    return( indices.empty() ? NULL : indices.data() );
+}
+
+///
+/// Retrieve the type of the element data in this Canvas
+///
+/// @return GL_UNSIGNED_SHORT if the indices fit in 16 bits in
+///         indexed mode, else GL_UNSIGNED_INT
+///
+GLenum Canvas::elementType( void ) const
+{
+    weld();
+
+    return( shortIndices.empty() ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT );
+}
+
 ///
 /// Retrieve the array of element data from this Canvas
 ///
@@ -318,11 +1249,15 @@ GLuint *Canvas::getElements( void )
             cerr << "element allocation failure" << endl;
             exit( 1 );
         }
+        weld();
         for( int i = 0; i < n; i++ ) {
-            elemArray[i] = i;
+            elemArray[i] = indices[i];
         }
     }
 
+    elemBytes = n > 0 ? n * sizeof(GLuint) : 0;
+    notePeak();
+
     return elemArray;
 }
 
@@ -339,7 +1274,8 @@ float *Canvas::getVertices( void )
         pointArray = 0;
     }
 
-    int n = points.size();
+    AttribView view = viewVertices();
+    int n = view.length;
 
     if( n > 0 ) {
         // create and fill a new point array
@@ -349,10 +1285,13 @@ float *Canvas::getVertices( void )
             exit( 1 );
         }
         for( int i = 0; i < n; i++ ) {
-            pointArray[i] = points[i];
+            pointArray[i] = view.data[i];
         }
     }
 
+    pointBytes = n > 0 ? n * sizeof(float) : 0;
+    notePeak();
+
     return pointArray;
 }
 
@@ -369,7 +1308,8 @@ float *Canvas::getNormals( void )
         normalArray = 0;
     }
 
-    int n = normals.size();
+    AttribView view = viewNormals();
+    int n = view.length;
 
     if( n > 0 ) {
         // create and fill a new normal array
@@ -379,10 +1319,13 @@ float *Canvas::getNormals( void )
             exit( 1 );
         }
         for( int i = 0; i < n; i++ ) {
-            normalArray[i] = normals[i];
+            normalArray[i] = view.data[i];
         }
     }
 
+    normalBytes = n > 0 ? n * sizeof(float) : 0;
+    notePeak();
+
     return normalArray;
 }
 
@@ -399,7 +1342,8 @@ float *Canvas::getUV( void )
         uvArray = 0;
     }
 
-    int n = uv.size();
+    AttribView view = viewUV();
+    int n = view.length;
 
     if( n > 0 ) {
         // create and fill a new texture coordinate array
@@ -409,10 +1353,13 @@ float *Canvas::getUV( void )
             exit( 1 );
         }
         for( int i = 0; i < n; i++ ) {
-            uvArray[i] = uv[i];
+            uvArray[i] = view.data[i];
         }
     }
 
+    uvBytes = n > 0 ? n * sizeof(float) : 0;
+    notePeak();
+
     return uvArray;
 }
 
@@ -429,7 +1376,8 @@ float *Canvas::getColors( void )
         colorArray = 0;
     }
 
-    int n = colors.size();
+    AttribView view = viewColors();
+    int n = view.length;
 
     if( n > 0 ) {
         // create and fill a new color array
@@ -439,19 +1387,37 @@ float *Canvas::getColors( void )
             exit( 1 );
         }
         for( int i = 0; i < n; i++ ) {
-            colorArray[i] = colors[i];
+            colorArray[i] = view.data[i];
         }
     }
 
+    colorBytes = n > 0 ? n * sizeof(float) : 0;
+    notePeak();
+
     return colorArray;
 }
 
 ///
 /// Retrieve the vertex count from this Canvas
 ///
-/// @return The number of vertices in the canvas
+/// @return The number of vertices in the canvas (after welding,
+///         in indexed mode)
 ///
 int Canvas::numVertices( void )
+{
+    if( indexed ) {
+        weld();
+        return( wPoints.size() / 4 );
+    }
+    return numElements;
+}
+
+///
+/// Retrieve the element count from this Canvas
+///
+/// @return The number of elements (indices) in the canvas
+///
+int Canvas::numIndices( void )
 {
     return numElements;
 }
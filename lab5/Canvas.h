@@ -53,6 +53,77 @@ using namespace std;
 
 #include <vector>
 
+///
+/// A read-only view of one of the Canvas attribute arrays.  The view
+/// refers directly to the Canvas' own storage; it is invalidated by
+/// anything that adds data to or clears the Canvas.
+///
+typedef struct st_attribview {
+    const float *data;  /// the data, or NULL if there is none
+    int length;         /// number of floats in the data
+} AttribView;
+
+///
+/// Ways of laying out vertex data
+///
+typedef enum vl_e {
+    VL_SEPARATE,        /// one contiguous array per attribute
+    VL_INTERLEAVED,     /// all attributes of a vertex stored together
+    VL_COMPACT          /// interleaved, with quantized attributes
+} VertexLayout;
+
+///
+/// Description of interleaved vertex data.  Attributes appear in the
+/// order position (XYZW), color (RGBA), normal (XYZ), and (u,v); all
+/// values are counts of floats, and absent attributes have offset -1.
+///
+typedef struct st_interleave {
+    int stride;         /// floats per vertex
+    int position;       /// offset of the position within a vertex
+    int color;          /// offset of the color, or -1
+    int normal;         /// offset of the normal, or -1
+    int uv;             /// offset of the (u,v) data, or -1
+} Interleaving;
+
+///
+/// Description of compact vertex data.  Each vertex holds, in order:
+///
+///     position    XYZ as floats (W is always 1)
+///     color       RGBA as unsigned bytes (normalized)
+///     normal      octahedral encoding as two shorts (normalized)
+///     (u,v)       UV as unsigned shorts (normalized), spanning the
+///                 (u,v) range of the whole mesh
+///
+/// Offsets and the stride are in bytes; absent attributes have
+/// offset -1.  The original (u,v) is uvBias + uvScale * stored value.
+///
+typedef struct st_compact {
+    int stride;         /// bytes per vertex
+    int position;       /// offset of the position within a vertex
+    int color;          /// offset of the color, or -1
+    int normal;         /// offset of the normal, or -1
+    int uv;             /// offset of the (u,v) data, or -1
+    float uvBias[2];    /// smallest u and v in the mesh
+    float uvScale[2];   /// extent of the u and v values in the mesh
+} CompactFormat;
+
+///
+/// Memory held by a Canvas, in bytes
+///
+typedef struct st_canvasmem {
+    size_t live;        /// attribute and derived data in use
+    size_t capacity;    /// allocated for attribute and derived data
+    size_t snapshots;   /// held in the copies made by the get*() functions
+    size_t peak;        /// largest capacity + snapshots seen so far
+} CanvasMemory;
+
+///
+/// Attributes to reserve space for, in addition to positions
+///
+#define CA_NORMALS      0x1
+#define CA_UV           0x2
+#define CA_COLORS       0x4
+
 ///
 /// Simple canvas class that allows for pixel-by-pixel rendering.
 ///
@@ -89,6 +160,70 @@ class Canvas {
     int numElements;
     GLuint *elemArray;
 
+    /// sizes of the get*() copies (bytes)
+    size_t pointBytes, normalBytes, uvBytes, colorBytes, elemBytes;
+
+    /// memory high-water mark (bytes)
+    mutable size_t peakBytes;
+
+    /// should clear() give back the memory it frees?
+    bool shrinkOnClear;
+
+    ///
+    /// Update the memory high-water mark
+    ///
+    void notePeak( void ) const;
+
+    ///
+    /// Free all the derived (welded, interleaved, compact) data
+    ///
+    void releaseDerived( void );
+
+    ///
+    /// indexed output
+    ///
+    /// In indexed mode, vertices with identical position, normal,
+    /// (u,v), and color data are welded into a single vertex, and the
+    /// element data indexes the welded vertices.  Welding is done when
+    /// the data is first retrieved after the Canvas has changed.
+    ///
+
+    /// are we producing indexed output?
+    bool indexed;
+
+    /// must the welded data and element data be rebuilt?
+    mutable bool weldStale;
+
+    /// welded vertex data
+    mutable vector<float> wPoints;
+    mutable vector<float> wNormals;
+    mutable vector<float> wUV;
+    mutable vector<float> wColors;
+
+    /// element data, also kept as 16-bit indices when they fit
+    mutable vector<GLuint> indices;
+    mutable vector<GLushort> shortIndices;
+
+    ///
+    /// Rebuild the welded and element data if it is out of date
+    ///
+    void weld( void ) const;
+
+    /// interleaved vertex data and its description
+    mutable bool interleaveStale;
+    mutable vector<float> interleaved;
+    mutable Interleaving interleaving;
+
+    /// compact vertex data and its description
+    mutable bool compactStale;
+    mutable vector<unsigned char> compact;
+    mutable CompactFormat compactFormat;
+
+    ///
+    /// Note that the Canvas contents have changed
+    ///
+    void modified( void );
+
     ///
     /// other Canvas defaults
     ///
@@ -122,6 +257,32 @@ public:
     ///
     void clear( void );
 
+    ///
+    /// Release memory that isn't in use:  spare capacity in the
+    /// attribute data, and all derived (welded, interleaved, compact)
+    /// data, which will be rebuilt when next needed.  The get*()
+    /// copies are left alone.
+    ///
+    /// @return  The number of bytes released
+    ///
+    size_t shrink( void );
+
+    ///
+    /// Choose whether clear() releases the Canvas' memory, or keeps
+    /// it for reuse (the default)
+    ///
+    /// @param on  true to release memory on clear()
+    /// @return    The old setting
+    ///
+    bool setShrinkOnClear( bool on );
+
+    ///
+    /// Report the memory held by this Canvas
+    ///
+    /// @return  The current usage and the high-water mark
+    ///
+    CanvasMemory memoryReport( void ) const;
+
     ///
     /// Set the pixel Z coordinate
     ///
@@ -138,6 +299,15 @@ public:
     ///
     Color setColor( Color color );
 
+    ///
+    /// Select indexed output, in which duplicate vertices are welded
+    /// together and the element data indexes the unique vertices
+    ///
+    /// @param on  true for indexed output, false for one vertex per element
+    /// @return    The old setting
+    ///
+    bool setIndexed( bool on );
+
     /////////////////////////////////////
     //
     // Adding things to the Canvas
@@ -202,7 +372,7 @@ public:
     ///
     /// Add a triangle to the current shape
     ///
-    /// Calculates a triangle-wide surface normal and adds that as well
+    /// Calculates a triangle-wide unit surface normal and adds that as well
     ///
     /// @param p0   first triangle vertex
     /// @param p1   second triangle vertex
@@ -232,12 +402,148 @@ public:
     ///
     void addTextureCoords( TexCoord uv0, TexCoord uv1, TexCoord uv2 );
 
+    ///
+    /// Make room for more vertices, so that adding them doesn't
+    /// repeatedly grow the Canvas' storage
+    ///
+    /// @param nVerts  The number of vertices about to be added
+    /// @param attrs   Which other attributes they will have
+    ///                (CA_NORMALS, CA_UV, and/or CA_COLORS)
+    ///
+    void reserve( int nVerts, int attrs );
+
+    ///
+    /// Add a batch of triangles to the current shape
+    ///
+    /// Each array holds 3 * count entries, one per triangle vertex.
+    /// Strides are the distances in bytes between consecutive entries;
+    /// a stride of 0 means the entries are tightly packed.
+    ///
+    /// @param count       number of triangles
+    /// @param pos         vertex positions (W is ignored)
+    /// @param posStride   stride of the positions
+    /// @param norm        vertex normals (or NULL for each
+    ///                    triangle's unit face normal)
+    /// @param normStride  stride of the normals
+    /// @param tex         vertex (u,v) data (or NULL)
+    /// @param uvStride    stride of the (u,v) data
+    ///
+    void addTriangles( int count, const Vertex *pos, size_t posStride,
+                       const Normal *norm, size_t normStride,
+                       const TexCoord *tex, size_t uvStride );
+
+    ///
+    /// Replace the normals of the current shape with smooth vertex
+    /// normals
+    ///
+    /// Vertices at coincident positions are welded together, and each
+    /// gets the angle-weighted average of the face normals around it;
+    /// faces meeting at more than the crease angle are not averaged,
+    /// leaving a hard edge.  Treats every three vertices as a triangle.
+    ///
+    /// @param creaseAngle    The crease angle, in degrees
+    /// @param weldTolerance  How close positions must be to be welded,
+    ///                       as a fraction of the shape's largest extent
+    ///
+    void computeSmoothNormals( float creaseAngle,
+                               float weldTolerance = 1.0e-6f );
+
+    ///
+    /// Append the contents of another Canvas to this one
+    ///
+    /// Both must carry the same set of attributes (unless one of them
+    /// is empty), so that the attribute data stays matched up with the
+    /// vertices; if they don't, nothing is appended.
+    ///
+    /// Only the vertices and their attributes are copied.  The source's
+    /// welded and element data are not:  the result is indexed (or not)
+    /// as this Canvas is, and its derived data is rebuilt when needed.
+    ///
+    /// @param src  The Canvas to copy from
+    /// @return     true if the contents were appended
+    ///
+    bool append( const Canvas &src );
+
     /////////////////////////////////////
     //
     // Retrieving things from the Canvas
     //
     /////////////////////////////////////
 
+    ///
+    /// The view*() functions return the data in place, without any
+    /// allocation or copying.  The get*() functions return a copy of
+    /// the data, which the Canvas keeps until the next get*() call for
+    /// the same data or the next clear().
+    ///
+
+    ///
+    /// View the vertex data in this Canvas
+    ///
+    /// @return A view of the data (XYZW per vertex)
+    ///
+    AttribView viewVertices( void ) const;
+
+    ///
+    /// View the normal data in this Canvas
+    ///
+    /// @return A view of the data (XYZ per vertex)
+    ///
+    AttribView viewNormals( void ) const;
+
+    ///
+    /// View the (u,v) data in this Canvas
+    ///
+    /// @return A view of the data (UV per vertex)
+    ///
+    AttribView viewUV( void ) const;
+
+    ///
+    /// View the color data in this Canvas
+    ///
+    /// @return A view of the data (RGBA per vertex)
+    ///
+    AttribView viewColors( void ) const;
+
+    ///
+    /// View all the vertex data in this Canvas, interleaved
+    ///
+    /// An attribute is included only if it was supplied for every
+    /// vertex.  In indexed mode, the welded vertices are interleaved.
+    ///
+    /// @param fmt  Where to return the layout of each vertex
+    /// @return     A view of the data (fmt.stride floats per vertex)
+    ///
+    AttribView viewInterleaved( Interleaving &fmt ) const;
+
+    ///
+    /// View all the vertex data in this Canvas, interleaved and
+    /// quantized
+    ///
+    /// An attribute is included only if it was supplied for every
+    /// vertex.  In indexed mode, the welded vertices are used.
+    ///
+    /// @param fmt  Where to return the layout of each vertex
+    /// @return     numVertices() vertices of fmt.stride bytes, or NULL
+    ///
+    const GLvoid *viewCompact( CompactFormat &fmt ) const;
+
+    ///
+    /// View the element data in this Canvas
+    ///
+    /// @return A pointer to numIndices() indices of type elementType(),
+    ///         or NULL
+    ///
+    const GLvoid *viewElements( void ) const;
+
+    ///
+    /// Retrieve the type of the element data in this Canvas
+    ///
+    /// @return GL_UNSIGNED_SHORT if the indices fit in 16 bits in
+    ///         indexed mode, else GL_UNSIGNED_INT
+    ///
+    GLenum elementType( void ) const;
+
     ///
     /// Retrieve the array of element data from this Canvas
     ///
@@ -276,10 +582,18 @@ public:
     ///
     /// Retrieve the vertex count from this Canvas
     ///
-    /// @return The number of vertices in the canvas
+    /// @return The number of vertices in the canvas (after welding,
+    ///         in indexed mode)
     ///
     int numVertices( void );
 
+    ///
+    /// Retrieve the element count from this Canvas
+    ///
+    /// @return The number of elements (indices) in the canvas
+    ///
+    int numIndices( void );
+
 };
 
 #endif
@@ -13,6 +13,7 @@
 
 #include <cmath>
 #include <iostream>
+#include <vector>
 #include "Canvas.h"
 #include "CylinderData.h"
 #include "Cylinder.h"
@@ -25,60 +26,34 @@ using namespace std;
 void makeCylinder( Canvas &C )
 {
     // Only use the vertices for the body itself
-    for( int i = body.first; i <= body.last - 2; i += 3 ) {
+    int nVerts = ((body.last - body.first + 1) / 3) * 3;
 
-        // Calculate the base indices of the three vertices
-        int point1 = cylinderElements[i];
-        int point2 = cylinderElements[i + 1];
-        int point3 = cylinderElements[i + 2];
+    //gather the data for every triangle vertex, then add it in one batch
+    vector<Vertex> pos( nVerts );
+    vector<Normal> norm( nVerts );
+    vector<TexCoord> tex( nVerts );
 
-        Vertex p1 = cylinderVertices[point1];
-        Vertex p2 = cylinderVertices[point2];
-        Vertex p3 = cylinderVertices[point3];
+    float pi = 3.141592654;
 
-        // Calculate the normal vectors for each vertex
-        Normal n1, n2, n3;
+    for( int i = 0; i < nVerts; ++i ) {
+        Vertex p = cylinderVertices[cylinderElements[body.first + i]];
+
+        pos[i] = p;
 
         // Normals on the body run from the axis to the vertex, and
         // are in the XZ plane; thus, for a vertex at (Px,Py,Pz), the
         // corresponding point on the axis is (0,Py,0), and the normal is
         // P - Axis, or just (Px,0,Pz).
+        norm[i] = (Normal) { p.x, 0.0f, p.z };
 
-        n1 = (Normal) { p1.x, 0.0f, p1.z };
-        n2 = (Normal) { p2.x, 0.0f, p2.z };
-        n3 = (Normal) { p3.x, 0.0f, p3.z };
-
-        // Add this triangle to the collection
-        C.addTriangleWithNorms( p1, n1, p2, n2, p3, n3 );
-        
-        TexCoord p1_c = {0.00, 0.00};
-        TexCoord p2_c = {0.00, 0.00};
-        TexCoord p3_c = {0.00, 0.00};
-        
-        float pi = 3.141592654;
-        float u;
-        float v;
-        
-        //p1
-        u = atan(p1.x / p1.z)/pi;
-        p1_c.u  = u;
-        v = p1.y + 0.5;
-        p1_c.v = 1.0 - v; // invert
-        
-        //p2
-        u = atan(p2.x / p2.z)/pi;
-        p2_c.u  = u;
-        v = p2.y + 0.5;
-        p2_c.v = 1.0 - v; // invert
-        
-        //p3
-        u = atan(p3.x / p3.z)/pi;
-        p3_c.u  = u;
-        v = p3.y + 0.5;
-        p3_c.v = 1.0 - v; // invert
-        
-        C.addTextureCoords(p1_c, p2_c, p3_c);
+        float v = p.y + 0.5;
+        tex[i].u = atan(p.x / p.z)/pi;
+        tex[i].v = 1.0 - v; // invert
     }
+
+    C.reserve( nVerts, CA_NORMALS | CA_UV );
+    C.addTriangles( nVerts / 3, pos.data(), 0, norm.data(), 0,
+                    tex.data(), 0 );
 }
 
 ///
@@ -107,47 +82,26 @@ void makeDiscs( Canvas &C )
             nn = (Normal) { 0.0f, 1.0f, 0.0f };
         }
 
-        // Create the triangles
-        for( int i = first; i <= last - 2; i += 3 ) {
-
-            // Calculate the base indices of the three vertices
-            int point1 = cylinderElements[i];
-            int point2 = cylinderElements[i + 1];
-            int point3 = cylinderElements[i + 2];
-
-            Vertex p1 = cylinderVertices[point1];
-            Vertex p2 = cylinderVertices[point2];
-            Vertex p3 = cylinderVertices[point3];
-
-            // Add this triangle to the collection
-            C.addTriangleWithNorms( p1, nn, p2, nn, p3, nn );
-            
-            TexCoord p1_c = {0.00, 0.00};
-            TexCoord p2_c = {0.00, 0.00};
-            TexCoord p3_c = {0.00, 0.00};
-            
-            float u;
-            float v;
-            
-            //p1
-            u = p1.x + 0.5;
-            p1_c.u  = u;
-            v = p1.z + 0.5;
-            p1_c.v = 1.0 - v; // invert
-            
-            //p2
-            u = p2.x + 0.5;
-            p2_c.u  = u;
-            v = p2.z + 0.5;
-            p2_c.v = 1.0 - v; // invert
-            
-            //p3
-            u = p3.x + 0.5;
-            p3_c.u  = u;
-            v = p3.z + 0.5;
-            p3_c.v = 1.0 - v; // invert
-            
-            C.addTextureCoords(p1_c, p2_c, p3_c);
+        int nVerts = ((last - first + 1) / 3) * 3;
+
+        //gather the data for every triangle vertex
+        vector<Vertex> pos( nVerts );
+        vector<Normal> norm( nVerts, nn );
+        vector<TexCoord> tex( nVerts );
+
+        for( int i = 0; i < nVerts; ++i ) {
+            Vertex p = cylinderVertices[cylinderElements[first + i]];
+
+            pos[i] = p;
+
+            float v = p.z + 0.5;
+            tex[i].u = p.x + 0.5;
+            tex[i].v = 1.0 - v; // invert
         }
+
+        // Create the triangles
+        C.reserve( nVerts, CA_NORMALS | CA_UV );
+        C.addTriangles( nVerts / 3, pos.data(), 0, norm.data(), 0,
+                        tex.data(), 0 );
     }
 }
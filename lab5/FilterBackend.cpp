@@ -0,0 +1,665 @@
+///
+//  FilterBackend.cpp
+//
+//  A backend that drops redundant state changes
+//
+//  This file should not be modified by students.
+///
+
+#include <cstring>
+#include <map>
+#include <vector>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#ifndef __APPLE__
+#include <GL/glew.h>
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include "FilterBackend.h"
+
+using namespace std;
+
+///
+/// PRIVATE GLOBALS
+///
+
+/// where the calls that get through go
+static Backend *target = &glBackend;
+
+/// calls passed on and calls dropped, by kind
+static long passed[N_BACKEND_CALLS];
+static long dropped[N_BACKEND_CALLS];
+
+/// the program in use, and the active texture unit
+static GLuint program;
+static bool programKnown;
+static GLenum unit;
+static bool unitKnown;
+
+/// the vertex array bound
+static GLuint vertexArray;
+static bool vertexArrayKnown;
+
+/// buffers bound to each target
+static map<GLenum,GLuint> buffers;
+
+/// a range of a buffer bound to an indexed target (size -1 for all of it)
+typedef struct st_range {
+    GLuint buffer;
+    GLintptr offset;
+    GLsizeiptr size;
+} Range;
+
+/// ranges bound, by (target, index)
+static map< pair<GLenum,GLuint>, Range > ranges;
+
+/// textures bound, by (unit, target)
+static map< pair<GLenum,GLenum>, GLuint > textures;
+
+/// the last value sent to each uniform, by (program, location); the
+/// value is preceded by the call that sent it and its variant (e.g.,
+/// transposed or not), so that e.g. a vec4 and four floats don't
+/// compare equal
+static map< pair<GLuint,GLint>, vector<unsigned char> > uniforms;
+
+///
+/// PRIVATE FUNCTIONS
+///
+
+///
+/// pass(call) - count a call that gets through
+///
+/// @return true
+///
+static bool pass( BackendCall call ) {
+    passed[call] += 1;
+    return( true );
+}
+
+///
+/// drop(call) - count a call that doesn't
+///
+/// @return false
+///
+static bool drop( BackendCall call ) {
+    dropped[call] += 1;
+    return( false );
+}
+
+///
+/// changeUniform(call,location,data,bytes,variant) - does a uniform
+///     call change the variable's value in the program in use?
+///
+/// The value is compared where it lies with the one stored, and
+/// replaces it in the same storage, so repeated calls allocate nothing.
+///
+/// @return true if the call must be passed on
+///
+static bool changeUniform( BackendCall call, GLint location,
+                           const void *data, size_t bytes,
+                           int variant = 0 ) {
+    // setting location -1 is defined to do nothing at all
+    if( location < 0 ) {
+        return( drop( call ) );
+    }
+
+    if( !programKnown ) {
+        return( pass( call ) );
+    }
+
+    int tag[2] = { call, variant };
+    vector<unsigned char> &last = uniforms[ make_pair( program, location ) ];
+    if( last.size() == sizeof(tag) + bytes &&
+        memcmp( last.data(), tag, sizeof(tag) ) == 0 &&
+        memcmp( last.data() + sizeof(tag), data, bytes ) == 0 ) {
+        return( drop( call ) );
+    }
+
+    last.resize( sizeof(tag) + bytes );
+    memcpy( last.data(), tag, sizeof(tag) );
+    memcpy( last.data() + sizeof(tag), data, bytes );
+    return( pass( call ) );
+}
+
+///
+/// forgetProgram(prog) - forget the uniform values of a program that
+///     was relinked or deleted
+///
+static void forgetProgram( GLuint prog ) {
+    map< pair<GLuint,GLint>, vector<unsigned char> >::iterator it;
+
+    it = uniforms.lower_bound( make_pair( prog, (GLint) 0 ) );
+    while( it != uniforms.end() && it->first.first == prog ) {
+        uniforms.erase( it++ );
+    }
+}
+
+///
+/// forgetBuffer(buffer) - a deleted buffer is no longer bound anywhere
+///
+static void forgetBuffer( GLuint buffer ) {
+    map<GLenum,GLuint>::iterator b;
+    for( b = buffers.begin(); b != buffers.end(); ++b ) {
+        if( b->second == buffer ) {
+            b->second = 0;
+        }
+    }
+
+    map< pair<GLenum,GLuint>, Range >::iterator r = ranges.begin();
+    while( r != ranges.end() ) {
+        if( r->second.buffer == buffer ) {
+            ranges.erase( r++ );
+        } else {
+            ++r;
+        }
+    }
+}
+
+///
+/// The calls that are filtered
+///
+
+static void f_bindBuffer( GLenum tgt, GLuint buffer ) {
+    map<GLenum,GLuint>::iterator it = buffers.find( tgt );
+    if( it != buffers.end() && it->second == buffer ) {
+        drop( BC_BIND_BUFFER );
+        return;
+    }
+
+    pass( BC_BIND_BUFFER );
+    buffers[tgt] = buffer;
+    target->bindBuffer( tgt, buffer );
+}
+
+static void f_bindVertexArray( GLuint array ) {
+    if( vertexArrayKnown && vertexArray == array ) {
+        drop( BC_BIND_VERTEX_ARRAY );
+        return;
+    }
+
+    pass( BC_BIND_VERTEX_ARRAY );
+    vertexArray = array;
+    vertexArrayKnown = true;
+
+    // the element buffer binding is part of the vertex array
+    buffers.erase( GL_ELEMENT_ARRAY_BUFFER );
+
+    target->bindVertexArray( array );
+}
+
+static void f_useProgram( GLuint prog ) {
+    if( programKnown && program == prog ) {
+        drop( BC_USE_PROGRAM );
+        return;
+    }
+
+    pass( BC_USE_PROGRAM );
+    program = prog;
+    programKnown = true;
+    target->useProgram( prog );
+}
+
+static void f_uniform1i( GLint location, GLint v0 ) {
+    if( changeUniform( BC_UNIFORM1I, location, &v0, sizeof(v0) ) ) {
+        target->uniform1i( location, v0 );
+    }
+}
+
+static void f_uniform1f( GLint location, GLfloat v0 ) {
+    if( changeUniform( BC_UNIFORM1F, location, &v0, sizeof(v0) ) ) {
+        target->uniform1f( location, v0 );
+    }
+}
+
+static void f_uniform4f( GLint location, GLfloat v0, GLfloat v1,
+                         GLfloat v2, GLfloat v3 ) {
+    GLfloat v[4] = { v0, v1, v2, v3 };
+    if( changeUniform( BC_UNIFORM4F, location, v, sizeof(v) ) ) {
+        target->uniform4f( location, v0, v1, v2, v3 );
+    }
+}
+
+static void f_uniform3fv( GLint location, GLsizei count,
+                          const GLfloat *value ) {
+    if( changeUniform( BC_UNIFORM3FV, location, value,
+                       count * 3 * sizeof(GLfloat) ) ) {
+        target->uniform3fv( location, count, value );
+    }
+}
+
+static void f_uniform4fv( GLint location, GLsizei count,
+                          const GLfloat *value ) {
+    if( changeUniform( BC_UNIFORM4FV, location, value,
+                       count * 4 * sizeof(GLfloat) ) ) {
+        target->uniform4fv( location, count, value );
+    }
+}
+
+static void f_uniformMatrix4fv( GLint location, GLsizei count,
+                                GLboolean transpose, const GLfloat *value ) {
+    // a transposed matrix is a different value
+    if( changeUniform( BC_UNIFORM_MATRIX4FV, location, value,
+                       count * 16 * sizeof(GLfloat), transpose != 0 ) ) {
+        target->uniformMatrix4fv( location, count, transpose, value );
+    }
+}
+
+static void f_bindBufferBase( GLenum tgt, GLuint index, GLuint buffer ) {
+    pair<GLenum,GLuint> key( tgt, index );
+    map< pair<GLenum,GLuint>, Range >::iterator it = ranges.find( key );
+    if( it != ranges.end() && it->second.buffer == buffer &&
+        it->second.size < 0 ) {
+        drop( BC_BIND_BUFFER_BASE );
+        return;
+    }
+
+    pass( BC_BIND_BUFFER_BASE );
+    Range r = { buffer, 0, -1 };
+    ranges[key] = r;
+    // this binds the buffer to the generic target, too
+    buffers[tgt] = buffer;
+    target->bindBufferBase( tgt, index, buffer );
+}
+
+static void f_bindBufferRange( GLenum tgt, GLuint index, GLuint buffer,
+                               GLintptr offset, GLsizeiptr size ) {
+    pair<GLenum,GLuint> key( tgt, index );
+    map< pair<GLenum,GLuint>, Range >::iterator it = ranges.find( key );
+    if( it != ranges.end() && it->second.buffer == buffer &&
+        it->second.offset == offset && it->second.size == size ) {
+        drop( BC_BIND_BUFFER_RANGE );
+        return;
+    }
+
+    pass( BC_BIND_BUFFER_RANGE );
+    Range r = { buffer, offset, size };
+    ranges[key] = r;
+    buffers[tgt] = buffer;
+    target->bindBufferRange( tgt, index, buffer, offset, size );
+}
+
+static void f_activeTexture( GLenum texture ) {
+    if( unitKnown && unit == texture ) {
+        drop( BC_ACTIVE_TEXTURE );
+        return;
+    }
+
+    pass( BC_ACTIVE_TEXTURE );
+    unit = texture;
+    unitKnown = true;
+    target->activeTexture( texture );
+}
+
+static void f_bindTexture( GLenum tgt, GLuint texture ) {
+    if( !unitKnown ) {
+        pass( BC_BIND_TEXTURE );
+        target->bindTexture( tgt, texture );
+        return;
+    }
+
+    pair<GLenum,GLenum> key( unit, tgt );
+    map< pair<GLenum,GLenum>, GLuint >::iterator it = textures.find( key );
+    if( it != textures.end() && it->second == texture ) {
+        drop( BC_BIND_TEXTURE );
+        return;
+    }
+
+    pass( BC_BIND_TEXTURE );
+    textures[key] = texture;
+    target->bindTexture( tgt, texture );
+}
+
+///
+/// The calls that change what the filter knows
+///
+
+static void f_deleteBuffers( GLsizei n, const GLuint *names ) {
+    pass( BC_DELETE_BUFFERS );
+    for( GLsizei i = 0; i < n; ++i ) {
+        forgetBuffer( names[i] );
+    }
+    target->deleteBuffers( n, names );
+}
+
+static void f_deleteVertexArrays( GLsizei n, const GLuint *arrays ) {
+    pass( BC_DELETE_VERTEX_ARRAYS );
+    for( GLsizei i = 0; i < n; ++i ) {
+        if( vertexArrayKnown && vertexArray == arrays[i] ) {
+            // deleting the bound vertex array binds 0
+            vertexArray = 0;
+            buffers.erase( GL_ELEMENT_ARRAY_BUFFER );
+        }
+    }
+    target->deleteVertexArrays( n, arrays );
+}
+
+static void f_linkProgram( GLuint prog ) {
+    pass( BC_LINK_PROGRAM );
+    forgetProgram( prog );
+    target->linkProgram( prog );
+}
+
+static void f_programBinary( GLuint prog, GLenum binaryFormat,
+                             const GLvoid *binary, GLsizei length ) {
+    pass( BC_PROGRAM_BINARY );
+    forgetProgram( prog );
+    target->programBinary( prog, binaryFormat, binary, length );
+}
+
+static void f_deleteProgram( GLuint prog ) {
+    pass( BC_DELETE_PROGRAM );
+    forgetProgram( prog );
+    target->deleteProgram( prog );
+}
+
+///
+/// The calls that are passed on as they are
+///
+
+static void f_genBuffers( GLsizei n, GLuint *names ) {
+    pass( BC_GEN_BUFFERS );
+    target->genBuffers( n, names );
+}
+
+static void f_bufferData( GLenum tgt, GLsizeiptr size,
+                          const GLvoid *data, GLenum usage ) {
+    pass( BC_BUFFER_DATA );
+    target->bufferData( tgt, size, data, usage );
+}
+
+static void f_bufferSubData( GLenum tgt, GLintptr offset,
+                             GLsizeiptr size, const GLvoid *data ) {
+    pass( BC_BUFFER_SUB_DATA );
+    target->bufferSubData( tgt, offset, size, data );
+}
+
+static void *f_mapBufferRange( GLenum tgt, GLintptr offset,
+                               GLsizeiptr length, GLbitfield access ) {
+    pass( BC_MAP_BUFFER_RANGE );
+    return( target->mapBufferRange( tgt, offset, length, access ) );
+}
+
+static GLboolean f_unmapBuffer( GLenum tgt ) {
+    pass( BC_UNMAP_BUFFER );
+    return( target->unmapBuffer( tgt ) );
+}
+
+static void f_copyBufferSubData( GLenum readTarget, GLenum writeTarget,
+                                 GLintptr readOffset, GLintptr writeOffset,
+                                 GLsizeiptr size ) {
+    pass( BC_COPY_BUFFER_SUB_DATA );
+    target->copyBufferSubData( readTarget, writeTarget, readOffset,
+                               writeOffset, size );
+}
+
+static void f_genVertexArrays( GLsizei n, GLuint *arrays ) {
+    pass( BC_GEN_VERTEX_ARRAYS );
+    target->genVertexArrays( n, arrays );
+}
+
+static void f_enableVertexAttribArray( GLuint index ) {
+    pass( BC_ENABLE_VERTEX_ATTRIB_ARRAY );
+    target->enableVertexAttribArray( index );
+}
+
+static void f_vertexAttribPointer( GLuint index, GLint size, GLenum type,
+                                   GLboolean normalized, GLsizei stride,
+                                   const GLvoid *pointer ) {
+    pass( BC_VERTEX_ATTRIB_POINTER );
+    target->vertexAttribPointer( index, size, type, normalized, stride,
+                                 pointer );
+}
+
+static void f_drawElements( GLenum mode, GLsizei count, GLenum type,
+                            const GLvoid *indices ) {
+    pass( BC_DRAW_ELEMENTS );
+    target->drawElements( mode, count, type, indices );
+}
+
+static void f_drawElementsBaseVertex( GLenum mode, GLsizei count,
+                                      GLenum type, const GLvoid *indices,
+                                      GLint basevertex ) {
+    pass( BC_DRAW_ELEMENTS_BASE_VERTEX );
+    target->drawElementsBaseVertex( mode, count, type, indices, basevertex );
+}
+
+static GLuint f_createShader( GLenum type ) {
+    pass( BC_CREATE_SHADER );
+    return( target->createShader( type ) );
+}
+
+static void f_shaderSource( GLuint shader, GLsizei count,
+                            const GLchar **string, const GLint *length ) {
+    pass( BC_SHADER_SOURCE );
+    target->shaderSource( shader, count, string, length );
+}
+
+static void f_compileShader( GLuint shader ) {
+    pass( BC_COMPILE_SHADER );
+    target->compileShader( shader );
+}
+
+static void f_getShaderiv( GLuint shader, GLenum pname, GLint *params ) {
+    pass( BC_GET_SHADERIV );
+    target->getShaderiv( shader, pname, params );
+}
+
+static void f_getShaderInfoLog( GLuint shader, GLsizei bufSize,
+                                GLsizei *length, GLchar *infoLog ) {
+    pass( BC_GET_SHADER_INFO_LOG );
+    target->getShaderInfoLog( shader, bufSize, length, infoLog );
+}
+
+static void f_deleteShader( GLuint shader ) {
+    pass( BC_DELETE_SHADER );
+    target->deleteShader( shader );
+}
+
+static GLuint f_createProgram( void ) {
+    pass( BC_CREATE_PROGRAM );
+    return( target->createProgram() );
+}
+
+static void f_attachShader( GLuint prog, GLuint shader ) {
+    pass( BC_ATTACH_SHADER );
+    target->attachShader( prog, shader );
+}
+
+static void f_getProgramiv( GLuint prog, GLenum pname, GLint *params ) {
+    pass( BC_GET_PROGRAMIV );
+    target->getProgramiv( prog, pname, params );
+}
+
+static void f_getProgramInfoLog( GLuint prog, GLsizei bufSize,
+                                 GLsizei *length, GLchar *infoLog ) {
+    pass( BC_GET_PROGRAM_INFO_LOG );
+    target->getProgramInfoLog( prog, bufSize, length, infoLog );
+}
+
+static GLint f_getAttribLocation( GLuint prog, const GLchar *name ) {
+    pass( BC_GET_ATTRIB_LOCATION );
+    return( target->getAttribLocation( prog, name ) );
+}
+
+static GLint f_getUniformLocation( GLuint prog, const GLchar *name ) {
+    pass( BC_GET_UNIFORM_LOCATION );
+    return( target->getUniformLocation( prog, name ) );
+}
+
+static void f_getActiveAttrib( GLuint prog, GLuint index, GLsizei bufSize,
+                               GLsizei *length, GLint *size, GLenum *type,
+                               GLchar *name ) {
+    pass( BC_GET_ACTIVE_ATTRIB );
+    target->getActiveAttrib( prog, index, bufSize, length, size, type, name );
+}
+
+static void f_getActiveUniform( GLuint prog, GLuint index, GLsizei bufSize,
+                                GLsizei *length, GLint *size, GLenum *type,
+                                GLchar *name ) {
+    pass( BC_GET_ACTIVE_UNIFORM );
+    target->getActiveUniform( prog, index, bufSize, length, size, type,
+                              name );
+}
+
+static void f_programParameteri( GLuint prog, GLenum pname, GLint value ) {
+    pass( BC_PROGRAM_PARAMETERI );
+    target->programParameteri( prog, pname, value );
+}
+
+static void f_getProgramBinary( GLuint prog, GLsizei bufSize,
+                                GLsizei *length, GLenum *binaryFormat,
+                                GLvoid *binary ) {
+    pass( BC_GET_PROGRAM_BINARY );
+    target->getProgramBinary( prog, bufSize, length, binaryFormat, binary );
+}
+
+static GLuint f_getUniformBlockIndex( GLuint prog,
+                                      const GLchar *uniformBlockName ) {
+    pass( BC_GET_UNIFORM_BLOCK_INDEX );
+    return( target->getUniformBlockIndex( prog, uniformBlockName ) );
+}
+
+static void f_uniformBlockBinding( GLuint prog, GLuint uniformBlockIndex,
+                                   GLuint uniformBlockBinding ) {
+    pass( BC_UNIFORM_BLOCK_BINDING );
+    target->uniformBlockBinding( prog, uniformBlockIndex,
+                                 uniformBlockBinding );
+}
+
+static void f_genTextures( GLsizei n, GLuint *names ) {
+    pass( BC_GEN_TEXTURES );
+    target->genTextures( n, names );
+}
+
+static void f_texParameteri( GLenum tgt, GLenum pname, GLint param ) {
+    pass( BC_TEX_PARAMETERI );
+    target->texParameteri( tgt, pname, param );
+}
+
+static void f_texImage2D( GLenum tgt, GLint level, GLint internalformat,
+                          GLsizei width, GLsizei height, GLint border,
+                          GLenum format, GLenum type, const GLvoid *pixels ) {
+    pass( BC_TEX_IMAGE_2D );
+    target->texImage2D( tgt, level, internalformat, width, height, border,
+                        format, type, pixels );
+}
+
+static const GLubyte *f_getString( GLenum name ) {
+    pass( BC_GET_STRING );
+    return( target->getString( name ) );
+}
+
+static void f_getIntegerv( GLenum pname, GLint *data ) {
+    pass( BC_GET_INTEGERV );
+    target->getIntegerv( pname, data );
+}
+
+static GLenum f_getError( void ) {
+    pass( BC_GET_ERROR );
+    return( target->getError() );
+}
+
+static GLboolean f_hasCapability( Capability cap ) {
+    return( target->hasCapability( cap ) );
+}
+
+///
+/// PUBLIC GLOBALS
+///
+
+Backend filterBackend = {
+    "filter",
+    f_genBuffers, f_bindBuffer, f_bufferData, f_bufferSubData,
+    f_mapBufferRange, f_unmapBuffer, f_copyBufferSubData,
+    f_deleteBuffers,
+    f_genVertexArrays, f_bindVertexArray, f_deleteVertexArrays,
+    f_enableVertexAttribArray, f_vertexAttribPointer,
+    f_drawElements, f_drawElementsBaseVertex,
+    f_createShader, f_shaderSource, f_compileShader,
+    f_getShaderiv, f_getShaderInfoLog, f_deleteShader,
+    f_createProgram, f_attachShader, f_linkProgram,
+    f_useProgram,
+    f_getProgramiv, f_getProgramInfoLog, f_deleteProgram,
+    f_getAttribLocation, f_getUniformLocation,
+    f_getActiveAttrib, f_getActiveUniform,
+    f_programParameteri, f_getProgramBinary, f_programBinary,
+    f_uniform1i, f_uniform1f, f_uniform4f, f_uniform3fv,
+    f_uniform4fv, f_uniformMatrix4fv,
+    f_bindBufferBase, f_bindBufferRange,
+    f_getUniformBlockIndex, f_uniformBlockBinding,
+    f_activeTexture, f_bindTexture, f_genTextures,
+    f_texParameteri, f_texImage2D,
+    f_getString, f_getIntegerv, f_getError,
+    f_hasCapability
+};
+
+///
+/// PUBLIC FUNCTIONS
+///
+
+///
+/// Select the backend that filterBackend passes calls on to
+///
+/// @param b  the backend (NULL selects glBackend)
+/// @return   the previous one
+///
+Backend *setFilterTarget( Backend *b ) {
+    Backend *old = target;
+
+    target = (b != NULL && b != &filterBackend) ? b : &glBackend;
+    filterReset();
+    return( old );
+}
+
+///
+/// Forget the shadow state
+///
+void filterReset( void ) {
+    programKnown = unitKnown = vertexArrayKnown = false;
+    buffers.clear();
+    ranges.clear();
+    textures.clear();
+    uniforms.clear();
+}
+
+///
+/// Get the number of calls of one kind that were dropped as redundant
+///
+/// @param call  the call
+/// @return the count
+///
+long filteredCalls( BackendCall call ) {
+    if( call < 0 || call >= N_BACKEND_CALLS ) {
+        return( 0 );
+    }
+
+    return( dropped[call] );
+}
+
+///
+/// Print how many calls were passed on and how many were dropped
+///
+/// @param fp  where to print them
+///
+void filterReport( FILE *fp ) {
+    long in = 0, out = 0;
+
+    fprintf( fp, "Filter (to '%s') calls:    passed    dropped\n",
+             target->name );
+    for( int i = 0; i < N_BACKEND_CALLS; ++i ) {
+        if( dropped[i] > 0 ) {
+            fprintf( fp, "  %-28s %8ld %10ld\n",
+                     backendCallName( (BackendCall) i ), passed[i],
+                     dropped[i] );
+        }
+        in += passed[i] + dropped[i];
+        out += passed[i];
+    }
+    fprintf( fp, "  total: %ld calls, %ld passed on, %ld dropped\n",
+             in, out, in - out );
+}
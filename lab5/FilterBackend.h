@@ -0,0 +1,66 @@
+///
+//  FilterBackend.h
+//
+//  A backend that drops redundant state changes
+//
+//  filterBackend keeps a shadow copy of the state that the modules set
+//  over and over - the program in use, bound buffers, vertex arrays,
+//  and textures, the active texture unit, the uniform buffer ranges,
+//  and the values of uniform variables - and passes a call on to the
+//  backend behind it only if it would change that state.  Everything
+//  else is passed on as it is.
+//
+//  State that isn't known yet (e.g., the texture bound to a unit before
+//  any glBindTexture() came through the filter) is never assumed, so
+//  the first call that sets it always gets through.  If anything
+//  changes the state without going through the filter, filterReset()
+//  must be called to forget what it knew.
+//
+//  This code can be compiled as either C or C++.
+//
+//  This file should not be modified by students.
+///
+
+#ifndef _FILTERBACKEND_H_
+#define _FILTERBACKEND_H_
+
+#include <stdio.h>
+
+#include "Backend.h"
+
+///
+/// The filtering backend
+///
+extern Backend filterBackend;
+
+///
+/// Select the backend that filterBackend passes calls on to; this
+/// also forgets the shadow state
+///
+/// @param b  the backend (NULL selects glBackend)
+/// @return   the previous one
+///
+Backend *setFilterTarget( Backend *b );
+
+///
+/// Forget the shadow state, so that the next call setting each piece
+/// of it gets through
+///
+void filterReset( void );
+
+///
+/// Get the number of calls of one kind that were dropped as redundant
+///
+/// @param call  the call
+/// @return the count
+///
+long filteredCalls( BackendCall call );
+
+///
+/// Print how many calls were passed on and how many were dropped
+///
+/// @param fp  where to print them
+///
+void filterReport( FILE *fp );
+
+#endif
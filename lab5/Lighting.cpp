@@ -13,6 +13,13 @@
 #include "Lighting.h"
 #include "Shapes.h"
 #include "Utils.h"
+#include "UniformBlocks.h"
+
+#ifdef __cplusplus
+#include <cstring>
+#else
+#include <string.h>
+#endif
 
 #ifdef __cplusplus
 using namespace std;
@@ -28,6 +35,10 @@ GLfloat lightpos[4]   = { 15.0f, 18.0f, 20.0f, 1.0f };
 static GLfloat lightcolor[4] = {  1.0f,  1.0f,  1.0f, 1.0f };
 static GLfloat amblight[4]   = {  0.7f,  0.7f,  0.7f, 1.0f };
 
+// handles of the uniform variables we use, and the program they're in
+static ProgramKey uProgram;
+static UniformVec4 lightPositionU, lightColorU, ambientLightU;
+
 ///
 // This function sets up the lighting parameters for the shaders.
 //
@@ -36,15 +47,24 @@ static GLfloat amblight[4]   = {  0.7f,  0.7f,  0.7f, 1.0f };
 ///
 void setLighting( GLuint program )
 {
-    GLint loc;
+    // with uniform blocks, these are uploaded only when they change
+    if( usesUniformBlocks( program ) ) {
+        LightBlock *lb = lightBlock();
+        memcpy( lb->lightPosition, lightpos, sizeof(lightpos) );
+        memcpy( lb->lightColor, lightcolor, sizeof(lightcolor) );
+        memcpy( lb->ambientLight, amblight, sizeof(amblight) );
+        return;
+    }
 
-    // Lighting parameters
-    loc = getUniformLoc( program, "lightPosition" );
-    glUniform4fv( loc, 1, lightpos );
-
-    loc = getUniformLoc( program, "lightColor" );
-    glUniform4fv( loc, 1, lightcolor );
+    // look up the variables once per program
+    if( !checkProgram( &uProgram, program ) ) {
+        lightPositionU = uniformVec4( program, "lightPosition" );
+        lightColorU = uniformVec4( program, "lightColor" );
+        ambientLightU = uniformVec4( program, "ambientLight" );
+    }
 
-    loc = getUniformLoc( program, "ambientLight" );
-    glUniform4fv( loc, 1, amblight );
+    // Lighting parameters
+    sendVec4( lightPositionU, lightpos );
+    sendVec4( lightColorU, lightcolor );
+    sendVec4( ambientLightU, amblight );
 }
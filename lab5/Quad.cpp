@@ -12,6 +12,7 @@
 ///
 
 #include <cmath>
+#include <vector>
 
 #include "Types.h"
 #include "Canvas.h"
@@ -27,27 +28,27 @@ using namespace std;
 ///
 void makeQuad( Canvas &C )
 {
-    for( int i = 0; i < quadElementsLength - 2; i += 3 ) {
+    int nTriangles = quadElementsLength / 3;
+    int nVerts = nTriangles * 3;
 
-        // Calculate the base indices of the three vertices
-        int point1 = quadElements[i];
-        int point2 = quadElements[i + 1];
-        int point3 = quadElements[i + 2];
+    // gather the data for every triangle vertex, and then hand it
+    // all to the Canvas in a single batch
+    vector<Vertex> pos( nVerts );
+    vector<Normal> norm( nVerts );
+    vector<TexCoord> tex( nVerts );
 
-        Vertex p1 = quadVertices[point1];
-        Vertex p2 = quadVertices[point2];
-        Vertex p3 = quadVertices[point3];
+    // all the vertices share the same surface normal
+    Normal nn = { quadNormals[0], quadNormals[1], quadNormals[2] };
 
-        // Calculate the surface normals for the three vertices
-        Normal n1 = { quadNormals[0], quadNormals[1], quadNormals[2] };
-        Normal n2 = n1;
-        Normal n3 = n2;
+    for( int i = 0; i < nVerts; ++i ) {
+        int point = quadElements[i];
 
-        // Add this triangle to the collection
-        C.addTriangleWithNorms( p1, n1, p2, n2, p3, n3 );
-
-        // Add the texture coordinates
-        C.addTextureCoords( quadUV[point1], quadUV[point2],
-                            quadUV[point3] );
+        pos[i] = quadVertices[point];
+        norm[i] = nn;
+        tex[i] = quadUV[point];
     }
+
+    C.reserve( nVerts, CA_NORMALS | CA_UV );
+    C.addTriangles( nTriangles, pos.data(), 0, norm.data(), 0,
+                    tex.data(), 0 );
 }
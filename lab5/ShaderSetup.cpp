@@ -6,7 +6,7 @@
 ///  Based on code from www.lighthouse3d.com
 ///
 ///  This module provides a simple way to create GLSL shader programs.
-///  It has three primary entry points:
+///  It has these primary entry points:
 ///
 ///      shaderSetup(vsfile,fsfile,err)
 ///      shaderSetupStr(vsstr,fsstr,err)
@@ -30,6 +30,16 @@
 ///          creates a shader program object, attaches all the shader
 ///          objects to it, and links the result.
 ///
+///      shaderSetupDefs(vsfile,fsfile,defines,err)
+///          As shaderSetup(), but with a set of #define lines inserted
+///          into both shaders just after their #version lines, so that
+///          one pair of source files can be compiled in several variants.
+///
+///  Programs set up from source by shaderSetup(), shaderSetupStr(), and
+///  shaderSetupDefs() are also saved in a cache directory (see
+///  shaderCacheDir()) as driver-specific binaries, which later runs load
+///  instead of compiling the source again.
+///
 
 #include <iostream>
 #include <cstdlib>
@@ -37,11 +47,204 @@
 // we use stdio for sprintf()
 #include <cstdio>
 
+#include <sys/stat.h>
+#if defined(_WIN32) || defined(_WIN64)
+#include <direct.h>
+#endif
+
 #include "ShaderSetup.h"
 #include "Utils.h"
+#include "Backend.h"
 
 using namespace std;
 
+///
+/// Program binary cache
+///
+
+/// where linked programs are cached, or empty if they aren't
+static char cacheDir[1024] = "shadercache";
+
+/// a cached program file begins with this header
+typedef struct st_cacheheader {
+    unsigned int magic;     /// CACHE_MAGIC
+    GLenum format;          /// binary format, from glGetProgramBinary()
+    GLint length;           /// number of bytes of binary that follow
+} CacheHeader;
+
+#define CACHE_MAGIC     0x50425347      // "GSBP"
+
+///
+/// FNV-1a hashing, 64-bit version
+///
+#define FNV_BASIS       14695981039346656037ull
+#define FNV_PRIME       1099511628211ull
+
+///
+/// canCachePrograms() - can we get and load program binaries?
+///
+static bool canCachePrograms( void ) {
+    return( backend->hasCapability( CAP_PROGRAM_BINARY ) );
+}
+
+///
+/// hashString(h,str) - add a string, and its terminating NUL, to an
+///     FNV-1a hash
+///
+static unsigned long long hashString( unsigned long long h,
+                                      const char *str ) {
+    if( str == NULL ) {
+        str = "";
+    }
+
+    do {
+        h = (h ^ (unsigned char) *str) * FNV_PRIME;
+    } while( *str++ );
+
+    return( h );
+}
+
+///
+/// cachePath(vsrc,fsrc,path,size) - where would the program linked
+///     from these sources be cached?
+///
+/// The name comes from a hash of the sources and of the driver
+/// identification, so that a new driver won't be offered binaries
+/// made by an old one.
+///
+/// @return true if there is a cache to use
+///
+static bool cachePath( const GLchar *vsrc, const GLchar *fsrc,
+                       char *path, size_t size ) {
+    if( cacheDir[0] == '\0' || !canCachePrograms() ) {
+        return( false );
+    }
+
+    unsigned long long h = FNV_BASIS;
+    h = hashString( h, vsrc );
+    h = hashString( h, fsrc );
+    h = hashString( h, (const char *) backend->getString( GL_VENDOR ) );
+    h = hashString( h, (const char *) backend->getString( GL_RENDERER ) );
+    h = hashString( h, (const char *) backend->getString( GL_VERSION ) );
+
+    snprintf( path, size, "%s/%016llx.bin", cacheDir, h );
+    return( true );
+}
+
+///
+/// loadProgram(path) - create a program from a cached binary
+///
+/// @return id of the program, or 0 if there was none or the driver
+///         rejected it (in which case the source must be compiled)
+///
+static GLuint loadProgram( const char *path ) {
+    FILE *fp = fopen( path, "rb" );
+    if( fp == NULL ) {
+        return( 0 );
+    }
+
+    // the rest of the file must be exactly the binary; a damaged
+    // length must not make us allocate more than the file holds
+    long size = -1;
+    if( fseek( fp, 0, SEEK_END ) == 0 ) {
+        size = ftell( fp );
+    }
+    rewind( fp );
+
+    CacheHeader hdr;
+    if( fread( &hdr, sizeof(hdr), 1, fp ) != 1 ||
+        hdr.magic != CACHE_MAGIC || hdr.length < 1 ||
+        size < (long) sizeof(hdr) ||
+        (long) hdr.length != size - (long) sizeof(hdr) ) {
+        fclose( fp );
+        return( 0 );
+    }
+
+    char *binary = new char[ hdr.length ];
+    size_t count = fread( binary, 1, hdr.length, fp );
+    fclose( fp );
+    if( count != (size_t) hdr.length ) {
+        delete [] binary;
+        return( 0 );
+    }
+
+    GLuint prog = backend->createProgram();
+    if( prog != 0 ) {
+        GLint flag;
+        backend->programBinary( prog, hdr.format, binary, hdr.length );
+        backend->getProgramiv( prog, GL_LINK_STATUS, &flag );
+        if( flag == GL_FALSE ) {
+            backend->deleteProgram( prog );
+            prog = 0;
+        } else {
+            reflectUniforms( prog );
+        }
+    }
+
+    delete [] binary;
+    return( prog );
+}
+
+///
+/// saveProgram(prog,path) - save a linked program's binary in the cache
+///
+static void saveProgram( GLuint prog, const char *path ) {
+    GLint length = 0;
+
+    backend->getProgramiv( prog, GL_PROGRAM_BINARY_LENGTH, &length );
+    if( length < 1 ) {
+        return;
+    }
+
+    CacheHeader hdr;
+    GLsizei count = 0;
+    char *binary = new char[ length ];
+    backend->getProgramBinary( prog, length, &count, &hdr.format, binary );
+    hdr.magic = CACHE_MAGIC;
+    hdr.length = count;
+
+    if( count > 0 ) {
+#if defined(_WIN32) || defined(_WIN64)
+        _mkdir( cacheDir );
+#else
+        mkdir( cacheDir, 0755 );
+#endif
+        // write a temporary file, and rename it once it's complete,
+        // so that no other run can see a partly-written binary
+        char tmp[1100];
+        snprintf( tmp, sizeof(tmp), "%s.tmp", path );
+        FILE *fp = fopen( tmp, "wb" );
+        if( fp != NULL ) {
+            bool ok = fwrite( &hdr, sizeof(hdr), 1, fp ) == 1 &&
+                      fwrite( binary, 1, count, fp ) == (size_t) count;
+            if( fclose( fp ) == 0 && ok ) {
+                rename( tmp, path );
+            } else {
+                remove( tmp );
+            }
+        }
+    }
+
+    delete [] binary;
+}
+
+///
+/// shaderCacheDir(dir)
+///
+/// Choose where linked programs are cached between runs.
+///
+/// @param dir   the directory (created when first needed), or NULL
+///              to stop caching programs
+///
+void shaderCacheDir( const char *dir ) {
+    if( dir == NULL ) {
+        cacheDir[0] = '\0';
+    } else {
+        strncpy( cacheDir, dir, sizeof(cacheDir) - 1 );
+        cacheDir[ sizeof(cacheDir) - 1 ] = '\0';
+    }
+}
+
 ///
 /// readTextFile(name)
 ///
@@ -104,7 +307,7 @@ void printShaderInfoLog( GLuint shader ) {
     char *log;
 
     // Determine the length of the information log
-    glGetShaderiv( shader, GL_INFO_LOG_LENGTH, &length );
+    backend->getShaderiv( shader, GL_INFO_LOG_LENGTH, &length );
 
     if( length > 0 ) {
 
@@ -114,7 +317,7 @@ void printShaderInfoLog( GLuint shader ) {
         if( log != NULL ) {
 
             // Retrieve the log
-            glGetShaderInfoLog( shader, length, &nchars, log );
+            backend->getShaderInfoLog( shader, length, &nchars, log );
 
             // Report it
             if( log[0] != '\0' ) {
@@ -146,7 +349,7 @@ void printProgramInfoLog( GLuint shader ) {
     char *log;
 
     // Determine the length of the information log
-    glGetProgramiv( shader, GL_INFO_LOG_LENGTH, &length );
+    backend->getProgramiv( shader, GL_INFO_LOG_LENGTH, &length );
 
     if( length > 0 ) {
 
@@ -156,7 +359,7 @@ void printProgramInfoLog( GLuint shader ) {
         if( log != NULL ) {
 
             // Retrieve the log
-            glGetProgramInfoLog( shader, length, &nchars, log );
+            backend->getProgramInfoLog( shader, length, &nchars, log );
 
             // Report it
             if( log[0] != '\0' ) {
@@ -285,7 +488,7 @@ GLuint shaderCreate( const GLchar **src, GLenum type, ShaderError *err ) {
     }
 
     // Create the shader object
-    id = glCreateShader( type );
+    id = backend->createShader( type );
 
     // Verify that we were able to get an ID
     if( id == 0 ) {
@@ -298,16 +501,16 @@ GLuint shaderCreate( const GLchar **src, GLenum type, ShaderError *err ) {
     }
 
     // Attach the source to the shaders
-    glShaderSource( id, num, src, NULL );
+    backend->shaderSource( id, num, src, NULL );
 
     // Compile the source, and print any relevant message logs
-    glCompileShader( id );
-    glGetShaderiv( id, GL_COMPILE_STATUS, &flag );
+    backend->compileShader( id );
+    backend->getShaderiv( id, GL_COMPILE_STATUS, &flag );
     printShaderInfoLog( id );
 
     // If the creation failed, dump the shader object
     if( flag == GL_FALSE ) {
-        glDeleteShader( id );
+        backend->deleteShader( id );
         switch( type ) {
         case GL_VERTEX_SHADER:    *err = E_VS_COMPILE; break;
         case GL_FRAGMENT_SHADER:  *err = E_FS_COMPILE; break;
@@ -340,7 +543,7 @@ GLuint shaderLink( GLuint ids[], size_t num, ShaderError *err ) {
     }
 
     // Create the program and attach the shaders
-    prog = glCreateProgram();
+    prog = backend->createProgram();
 
     if( prog == 0 ) {
         *err = E_PROG_ALLOC;
@@ -348,22 +551,31 @@ GLuint shaderLink( GLuint ids[], size_t num, ShaderError *err ) {
     }
 
     for( int i = 0; i < num; ++i ) {
-        glAttachShader( prog, ids[i] );
+        backend->attachShader( prog, ids[i] );
+    }
+
+    // ask the driver to keep the binary, in case we cache it
+    if( cacheDir[0] != '\0' && canCachePrograms() ) {
+        backend->programParameteri( prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                                    GL_TRUE );
     }
 
     // Report any message log information
     printProgramInfoLog( prog );
 
     // Link the program, and print any message log information
-    glLinkProgram( prog );
-    glGetProgramiv( prog, GL_LINK_STATUS, &flag );
+    backend->linkProgram( prog );
+    backend->getProgramiv( prog, GL_LINK_STATUS, &flag );
     printProgramInfoLog( prog );
     if( flag == GL_FALSE ) {
         *err = E_PROG_LINK;
-        glDeleteProgram( prog );
+        backend->deleteProgram( prog );
         return( 0 );
     }
 
+    // note its uniforms, so they needn't be looked up by name later
+    reflectUniforms( prog );
+
     return( prog );
 }
 
@@ -394,6 +606,16 @@ GLuint shaderSetupStr( const GLchar *vsrc, const GLchar *fsrc,
     // Assume that everything will work
     *err = E_NO_ERROR;
 
+    // If this program has been linked before, it may be in the cache
+    char path[1100];
+    bool cache = cachePath( vsrc, fsrc, path, sizeof(path) );
+    if( cache ) {
+        prog = loadProgram( path );
+        if( prog != 0 ) {
+            return( prog );
+        }
+    }
+
     // Create the shader objects
     src[0] = vsrc;
     src[1] = 0;
@@ -408,7 +630,7 @@ GLuint shaderSetupStr( const GLchar *vsrc, const GLchar *fsrc,
     fs = shaderCreate( src, GL_FRAGMENT_SHADER, err );
 
     if( fs == 0 ) {
-        glDeleteShader( vs );
+        backend->deleteShader( vs );
         return( 0 );
     }
 
@@ -418,13 +640,55 @@ GLuint shaderSetupStr( const GLchar *vsrc, const GLchar *fsrc,
     prog = shaderLink( ids, 2, err );
 
     if( prog == 0 ) {
-        glDeleteShader( vs );
-        glDeleteShader( fs );
+        backend->deleteShader( vs );
+        backend->deleteShader( fs );
+    } else if( cache ) {
+        saveProgram( prog, path );
     }
 
     return( prog );
 }
 
+///
+/// insertDefines(src,defines) - insert lines into shader source code
+///     after its #version line (or at the start, if it has none)
+///
+/// @param  src      the source code
+/// @param  defines  the lines to insert
+/// @return a dynamically-allocated copy of the source, with the lines
+///
+static GLchar *insertDefines( const GLchar *src, const char *defines ) {
+    const GLchar *p = src;
+
+    // #version must come first, so skip over it
+    while( *p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' ) {
+        ++p;
+    }
+    if( strncmp( p, "#version", 8 ) == 0 ) {
+        while( *p != '\0' && *p != '\n' ) {
+            ++p;
+        }
+        if( *p == '\n' ) {
+            ++p;
+        }
+    } else {
+        p = src;
+    }
+
+    size_t head = p - src, nd = strlen( defines ), rest = strlen( p );
+    GLchar *out = new GLchar[ head + nd + 1 + rest + 1 ];
+
+    memcpy( out, src, head );
+    memcpy( out + head, defines, nd );
+    // make sure the defines end a line
+    if( nd > 0 && defines[nd - 1] != '\n' ) {
+        out[head + nd++] = '\n';
+    }
+    memcpy( out + head + nd, p, rest + 1 );
+
+    return( out );
+}
+
 ///
 /// shaderSetup(vertex,fragment,err)
 ///
@@ -445,6 +709,31 @@ GLuint shaderSetupStr( const GLchar *vsrc, const GLchar *fsrc,
 ///      Returns 0, and assigns an error code to 'err'.
 ///
 GLuint shaderSetup( const char *vert, const char *frag, ShaderError *err ) {
+    return( shaderSetupDefs( vert, frag, NULL, err ) );
+}
+
+///
+/// shaderSetupDefs(vertex,fragment,defines,err)
+///
+/// Set up a GLSL shader program from source files, with a set of
+/// #define lines inserted into both shaders after their #version lines.
+/// The defines become part of the source, so each variant is cached
+/// separately.
+///
+/// @param  vert     vertex shader program source file
+/// @param  frag     fragment shader program source file
+/// @param  defines  lines to insert (e.g., "#define TEXTURED\n"), or NULL
+/// @param  err      pointer to status variable
+///
+/// On success:
+///      Returns the GLSL shader program handle, and sets the 'err'
+///      parameter to E_NO_ERROR.
+///
+/// On failure:
+///      Returns 0, and assigns an error code to 'err'.
+///
+GLuint shaderSetupDefs( const char *vert, const char *frag,
+                        const char *defines, ShaderError *err ) {
     GLchar *vsrc = NULL, *fsrc = NULL;
 
     // Read in shader source
@@ -463,6 +752,16 @@ GLuint shaderSetup( const char *vert, const char *frag, ShaderError *err ) {
         return( 0 );
     }
 
+    // Add the defines, if there are any
+    if( defines != NULL && defines[0] != '\0' ) {
+        GLchar *v = insertDefines( vsrc, defines );
+        GLchar *f = insertDefines( fsrc, defines );
+        delete [] vsrc;
+        delete [] fsrc;
+        vsrc = v;
+        fsrc = f;
+    }
+
     // Do the actual setup
     GLuint ret = shaderSetupStr( vsrc, fsrc, err );
 
@@ -61,6 +61,20 @@ void printShaderInfoLog( GLuint shader );
 ///
 void printProgramInfoLog( GLuint shader );
 
+///
+/// shaderCacheDir(dir)
+///
+/// Choose where linked programs are cached between runs.  Programs
+/// set up from source are saved there as driver-specific binaries, and
+/// reloaded on later runs unless the source or the driver has changed;
+/// a binary the driver rejects is simply compiled from source again.
+/// The default is "shadercache" in the current directory.
+///
+/// @param dir   the directory (created when first needed), or NULL
+///              to stop caching programs
+///
+void shaderCacheDir( const char *dir );
+
 ///
 /// errorString(code)
 ///
@@ -141,4 +155,28 @@ GLuint shaderSetupStr( const GLchar *vert, const GLchar *frag,
 ///
 GLuint shaderSetup( const char *vert, const char *frag, ShaderError *err );
 
+///
+/// shaderSetupDefs(vertex,fragment,defines,err)
+///
+/// Set up a GLSL shader program from source files, as shaderSetup()
+/// does, but with a set of #define lines inserted into both shaders
+/// just after their #version lines.  The defines are part of the
+/// source, so each variant is cached separately.
+///
+/// Arguments:
+/// @param vert     vertex shader program source file
+/// @param frag     fragment shader program source file
+/// @param defines  lines to insert (e.g., "#define TEXTURED\n"), or NULL
+/// @param err      pointer to status variable
+///
+/// On success:
+///      Returns the GLSL shader program handle, and sets the 'err'
+///      parameter to E_NO_ERROR.
+///
+/// On failure:
+///      Returns 0, and assigns an error code to 'err'.
+///
+GLuint shaderSetupDefs( const char *vert, const char *frag,
+                        const char *defines, ShaderError *err );
+
 #endif
@@ -0,0 +1,152 @@
+///
+//  ShaderVariants.cpp
+//
+//  Specialized variants of one pair of shaders
+//
+//  This file should not be modified by students.
+///
+
+#include <cstring>
+#include <string>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#ifndef __APPLE__
+#include <GL/glew.h>
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include "ShaderVariants.h"
+#include "UniformBlocks.h"
+#include "Utils.h"
+#include "Backend.h"
+
+using namespace std;
+
+///
+/// PRIVATE GLOBALS
+///
+
+/// the symbols the features define, in bit order
+static const char *featureNames[] = {
+    "TEXTURED", "TWO_SIDED", "FLAT_SHADING", "GOURAUD_SHADING",
+    "UNIFORM_BLOCKS"
+};
+
+#define N_FEATURES  (sizeof(featureNames) / sizeof(featureNames[0]))
+
+/// the source files, and the features every variant has
+static string vertFile, fragFile;
+static unsigned int commonFeatures;
+
+/// the variants compiled so far, indexed by their features, and the
+/// errors from those that failed (E_NO_ERROR if not tried yet)
+static GLuint programs[N_VARIANTS];
+static ShaderError errors[N_VARIANTS];
+
+///
+/// PRIVATE FUNCTIONS
+///
+
+///
+/// normalize(features) - reduce a set of features to the one variant
+///     that provides them, so that equivalent requests share it
+///
+static unsigned int normalize( unsigned int features ) {
+    features &= N_VARIANTS - 1;
+
+    // back face textures need textures
+    if( !(features & SV_TEXTURED) ) {
+        features &= ~SV_TWO_SIDED;
+    }
+
+    // flat shading wins over Gouraud shading
+    if( features & SV_FLAT ) {
+        features &= ~SV_GOURAUD;
+    }
+
+    return( features );
+}
+
+///
+/// PUBLIC FUNCTIONS
+///
+
+///
+/// Choose the shader source files
+///
+/// @param vert    vertex shader source file
+/// @param frag    fragment shader source file
+/// @param common  features every variant has
+///
+void variantSources( const char *vert, const char *frag,
+                     unsigned int common ) {
+    releaseVariants();
+
+    vertFile = vert;
+    fragFile = frag;
+    commonFeatures = common;
+}
+
+///
+/// Get the program for a variant, compiling it if need be
+///
+/// @param features  the features wanted (ShaderFeature bits)
+/// @param err       pointer to status variable
+/// @return the program, or 0 (with an error code in err)
+///
+GLuint variantProgram( unsigned int features, ShaderError *err ) {
+    unsigned int v = normalize( features | commonFeatures );
+
+    *err = errors[v];
+    if( programs[v] != 0 || errors[v] != E_NO_ERROR ) {
+        return( programs[v] );
+    }
+
+    if( vertFile.empty() || fragFile.empty() ) {
+        *err = E_NO_STRING;
+        return( 0 );
+    }
+
+    // one #define per feature
+    string defines;
+    for( unsigned int i = 0; i < N_FEATURES; ++i ) {
+        if( v & (1u << i) ) {
+            defines += "#define ";
+            defines += featureNames[i];
+            defines += "\n";
+        }
+    }
+
+    GLuint prog = shaderSetupDefs( vertFile.c_str(), fragFile.c_str(),
+                                   defines.c_str(), err );
+
+    if( prog != 0 && (v & SV_UNIFORM_BLOCKS) &&
+        !bindUniformBlocks( prog ) ) {
+        releaseProgram( prog );
+        prog = 0;
+        *err = E_PROG_LINK;
+    }
+
+    programs[v] = prog;
+    errors[v] = prog != 0 ? E_NO_ERROR : *err;
+
+    return( prog );
+}
+
+///
+/// Delete all the variants compiled so far, forgetting their uniform
+/// tables and uniform block connections
+///
+void releaseVariants( void ) {
+    for( int i = 0; i < N_VARIANTS; ++i ) {
+        if( programs[i] != 0 ) {
+            releaseProgram( programs[i] );
+            programs[i] = 0;
+        }
+        errors[i] = E_NO_ERROR;
+    }
+}
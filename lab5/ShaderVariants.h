@@ -0,0 +1,79 @@
+///
+//  ShaderVariants.h
+//
+//  Specialized variants of one pair of shaders
+//
+//  The shader source is written with #if defined(...) sections for
+//  each of the features below.  A variant is compiled, with the
+//  matching #define lines, the first time it's asked for, and kept
+//  until the sources are changed; each draw can then use a shader that
+//  does exactly what it needs, with no branching on uniform flags.
+//
+//  This code can be compiled as either C or C++.
+//
+//  This file should not be modified by students.
+///
+
+#ifndef _SHADERVARIANTS_H_
+#define _SHADERVARIANTS_H_
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#ifndef __APPLE__
+#include <GL/glew.h>
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include "ShaderSetup.h"
+
+///
+/// Features a variant can have, and the symbol each one defines
+///
+/// Without SV_FLAT or SV_GOURAUD, lighting is done per fragment (Phong
+/// shading); SV_TWO_SIDED only applies to textured variants.
+///
+typedef enum svfeature_e {
+    SV_TEXTURED       = 0x01,   /// TEXTURED
+    SV_TWO_SIDED      = 0x02,   /// TWO_SIDED
+    SV_FLAT           = 0x04,   /// FLAT_SHADING
+    SV_GOURAUD        = 0x08,   /// GOURAUD_SHADING
+    SV_UNIFORM_BLOCKS = 0x10,   /// UNIFORM_BLOCKS
+    // must be last:  the number of possible variants
+    N_VARIANTS        = 0x20
+} ShaderFeature;
+
+///
+/// Choose the shader source files, discarding any variants already
+/// compiled from others
+///
+/// @param vert    vertex shader source file
+/// @param frag    fragment shader source file
+/// @param common  features every variant has (e.g., SV_UNIFORM_BLOCKS)
+///
+void variantSources( const char *vert, const char *frag,
+                     unsigned int common );
+
+///
+/// Get the program for a variant, compiling it if need be.  A variant
+/// that failed to compile isn't tried again.
+///
+/// Variants with SV_UNIFORM_BLOCKS have their blocks connected to the
+/// binding points (see UniformBlocks.h); one that doesn't declare them
+/// all is treated as having failed to link.
+///
+/// @param features  the features wanted (ShaderFeature bits)
+/// @param err       pointer to status variable
+/// @return the program, or 0 (with an error code in err)
+///
+GLuint variantProgram( unsigned int features, ShaderError *err );
+
+///
+/// Delete all the variants compiled so far, forgetting their uniform
+/// tables and uniform block connections
+///
+void releaseVariants( void );
+
+#endif
@@ -16,6 +16,10 @@
 #include "Textures.h"
 #include "Shapes.h"
 #include "Utils.h"
+#include "Backend.h"
+#include "UniformBlocks.h"
+#include "ShaderVariants.h"
+#include <cstring>
 #include <SOIL/SOIL.h>
 
 using namespace std;
@@ -38,8 +42,18 @@ GLfloat specular[4]         = { 1.00f, 1.00f, 1.00f, 1.00f };
 /// Are we doing texture mapping instead of material properties?
 bool usingTextures = true;
 
+/// How is lighting done:  0 (Phong), SV_FLAT, or SV_GOURAUD?
+unsigned int shading = 0;
+
 /// Add any global definitions and/or variables you need here.
 
+/// handles of the uniform variables we use, and the program they're in
+static ProgramKey uProgram;
+static UniformFloat specExpU;
+static UniformVec3 kCoeffU;
+static UniformInt texFrontU, texBackU;
+static UniformVec4 specularColorU, diffuseColorU, ambientColorU;
+
 ///
 /// This function initializes all texture-related data structures for
 /// the program.  This is where texture buffers should be created, where
@@ -51,7 +65,7 @@ bool usingTextures = true;
 void initTextures( void )
 {
     // Load happy
-    glActiveTexture(GL_TEXTURE0);
+    backend->activeTexture(GL_TEXTURE0);
     GLuint tex_0 = SOIL_load_OGL_texture("happy.png", SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID,
                                              SOIL_FLAG_MIPMAPS | SOIL_FLAG_INVERT_Y | SOIL_FLAG_TEXTURE_REPEATS);
     // check if happy image was loaded
@@ -60,7 +74,7 @@ void initTextures( void )
     }
     
     // Load angry
-    glActiveTexture(GL_TEXTURE1);
+    backend->activeTexture(GL_TEXTURE1);
     GLuint tex_1 = SOIL_load_OGL_texture("angry.png", SOIL_LOAD_AUTO, SOIL_CREATE_NEW_ID,
                                              SOIL_FLAG_MIPMAPS | SOIL_FLAG_INVERT_Y | SOIL_FLAG_TEXTURE_REPEATS);
     // check if angry image was loaded
@@ -68,8 +82,8 @@ void initTextures( void )
         printf( "SOIL loading error with 'angry.png': '%s'\n", SOIL_last_result() );
     }
     
-    glBindTexture(GL_TEXTURE_2D, tex_0);
-    glBindTexture(GL_TEXTURE_2D, tex_1);
+    backend->bindTexture(GL_TEXTURE_2D, tex_0);
+    backend->bindTexture(GL_TEXTURE_2D, tex_1);
     
     // sphere and cyl
     int width, height;
@@ -80,13 +94,13 @@ void initTextures( void )
     GLuint tex_3;
     GLuint tex_4;
     
-    glGenTextures(1, &tex_2);
-    glGenTextures(1, &tex_3);
-    glGenTextures(1, &tex_4);
+    backend->genTextures(1, &tex_2);
+    backend->genTextures(1, &tex_3);
+    backend->genTextures(1, &tex_4);
 
     // Load cyl curve
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, tex_2);
+    backend->activeTexture(GL_TEXTURE2);
+    backend->bindTexture(GL_TEXTURE_2D, tex_2);
     image = SOIL_load_image("wall.png", &width, &height, 0, SOIL_LOAD_RGB );
     
     // check if wall image was loaded
@@ -94,17 +108,17 @@ void initTextures( void )
         printf( "SOIL loading error for 'wall.png': '%s'\n", SOIL_last_result() );
     }
     
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
-    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+    backend->texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    backend->texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    backend->texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    backend->texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    backend->texParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
+    backend->texImage2D( GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
     SOIL_free_image_data(image);
 
     // Load cyl ends
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, tex_3);
+    backend->activeTexture(GL_TEXTURE3);
+    backend->bindTexture(GL_TEXTURE_2D, tex_3);
     image = SOIL_load_image("disc.png", &width, &height, 0, SOIL_LOAD_RGB );
     
     // check if disc image was loaded
@@ -112,17 +126,17 @@ void initTextures( void )
         printf( "SOIL loading error for 'disc.png': '%s'\n", SOIL_last_result() );
     }
     
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
-    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+    backend->texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    backend->texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    backend->texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    backend->texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    backend->texParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
+    backend->texImage2D( GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
     SOIL_free_image_data(image);
     
     // Load Sphere
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D, tex_4);
+    backend->activeTexture(GL_TEXTURE4);
+    backend->bindTexture(GL_TEXTURE_2D, tex_4);
     image = SOIL_load_image("jupiter.jpg", &width, &height, 0, SOIL_LOAD_AUTO );
     
     // check if jupiter image was loaded
@@ -130,29 +144,64 @@ void initTextures( void )
         printf( "SOIL loading error for 'jupiter.jpg': '%s'\n", SOIL_last_result() );
     }
     
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
-    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+    backend->texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    backend->texParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    backend->texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    backend->texParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    backend->texParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
+    backend->texImage2D( GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
     SOIL_free_image_data(image);
     
     // since we want textures set this value to true
     usingTextures = true;
 }
 
+///
+/// Fill in an object's material block, for shaders that take their
+/// parameters from uniform blocks.  The values are the ones
+/// setTextures() would otherwise send as individual uniforms.
+///
+/// @param mb   the block
+/// @param obj  The object type of the object being drawn
+///
+static void fillMaterial( MaterialBlock *mb, int obj )
+{
+    const GLfloat *amb = quad_ambdiffuse, *diff = quad_ambdiffuse;
+
+    mb->specExp = quad_specExp;
+    switch( obj ) {
+    case OBJ_CYLINDER:  // FALL THROUGH
+    case OBJ_DISCS:
+        mb->specExp = cyl_specExp;
+        amb = cyl_ambient;
+        diff = cyl_diffuse;
+        break;
+    case OBJ_SPHERE:
+        mb->specExp = sph_specExp;
+        amb = sph_ambient;
+        diff = sph_diffuse;
+        break;
+    }
+
+    memcpy( mb->kCoeff, k, sizeof(k) );
+    mb->usingTextures = usingTextures;
+    memcpy( mb->specularColor, specular, sizeof(specular) );
+    memcpy( mb->ambientColor, amb, 4 * sizeof(GLfloat) );
+    memcpy( mb->diffuseColor, diff, 4 * sizeof(GLfloat) );
+}
+
 ///
 /// This function sets up the parameters for texture use.
 ///
 /// You will need to modify this function, and maintain all of the values
 /// needed to be sent to the various shaders.
 ///
-/// @param program The ID of an OpenGL (GLSL) shader program to which
-///    parameter values are to be sent
+/// @param program The ID of an OpenGL (GLSL) shader program to use if
+///    no variant can be had
 /// @param obj     The object type of the object being drawn
+/// @return the program now in use
 ///
-void setTextures( GLuint program, int obj )
+GLuint setTextures( GLuint program, int obj )
 {
     ///////////////////////////////////////////////////
     // CODE COMMON TO PHONG SHADING AND TEXTURE MAPPING
@@ -160,28 +209,58 @@ void setTextures( GLuint program, int obj )
     // DO NOT REMOVE THIS SECTION OF CODE
     ///////////////////////////////////////////////////
 
+    // Pick the shader variant for this object; only the quad has a
+    // texture on its back
+    unsigned int features = shading;
+    if( usingTextures ) {
+        features |= SV_TEXTURED;
+        if( obj == OBJ_QUAD ) {
+            features |= SV_TWO_SIDED;
+        }
+    }
+
+    ShaderError err;
+    GLuint variant = variantProgram( features, &err );
+    if( variant != 0 ) {
+        program = variant;
+    }
+    backend->useProgram( program );
+
+    // Look up the uniform variables once per program; those a variant
+    // doesn't have get no locations, and aren't sent
+    if( !checkProgram( &uProgram, program ) ) {
+        specExpU = uniformFloat( program, "specExp" );
+        kCoeffU = uniformVec3( program, "kCoeff" );
+        specularColorU = uniformVec4( program, "specularColor" );
+        diffuseColorU = uniformVec4( program, "diffuseColor" );
+        ambientColorU = uniformVec4( program, "ambientColor" );
+        texFrontU = uniformInt( program, "tex_f" );
+        texBackU = uniformInt( program, "tex_b" );
+    }
+
+    // With uniform blocks, the material goes into the object's block
+    // instead; the variables in it have no locations, so the sends
+    // below do nothing, other than those of the samplers.
+    if( usesUniformBlocks( program ) ) {
+        fillMaterial( materialBlock(), obj );
+    }
+
     // Set the specular exponent for the object
-    GLint loc  = getUniformLoc(program, "specExp");
     switch( obj ) {
     case OBJ_QUAD:
-        glUniform1f( loc, quad_specExp );
+        sendFloat( specExpU, quad_specExp );
         break;
     case OBJ_CYLINDER:  // FALL THROUGH
     case OBJ_DISCS:
-        glUniform1f( loc, cyl_specExp );
+        sendFloat( specExpU, cyl_specExp );
         break;
     case OBJ_SPHERE:
-        glUniform1f( loc, sph_specExp );
+        sendFloat( specExpU, sph_specExp );
         break;
     }
 
     // Send down the reflective coefficients
-    loc = getUniformLoc( program, "kCoeff" );
-    glUniform3fv( loc, 1, k );
-
-    // Send down the "are we texture mapping?" flag
-    loc = getUniformLoc( program, "usingTextures" );
-    glUniform1i( loc, usingTextures );
+    sendVec3( kCoeffU, k );
 
     ///////////////////////////////////////////////////////////
     // CODE DIFFERING BETWEEN PHONG SHADING AND TEXTURE MAPPING
@@ -200,48 +279,43 @@ void setTextures( GLuint program, int obj )
         ///////////////////////////////////////////////////////////
 
         // specular color is identical for the objects
-        loc = getUniformLoc( program, "specularColor" );
-        glUniform4fv( loc, 1, specular );
+        sendVec4( specularColorU, specular );
 
         // ambient and diffuse vary from one object to another
-        GLint dloc = getUniformLoc( program, "diffuseColor" );
-        GLint aloc = getUniformLoc( program, "ambientColor" );
-
         switch( obj ) {
         case OBJ_QUAD:
-            glUniform4fv( aloc, 1, quad_ambdiffuse );
-            glUniform4fv( dloc, 1, quad_ambdiffuse );
+            sendVec4( ambientColorU, quad_ambdiffuse );
+            sendVec4( diffuseColorU, quad_ambdiffuse );
             break;
         case OBJ_CYLINDER: // FALL THROUGH
         case OBJ_DISCS:
-            glUniform4fv( aloc, 1, cyl_ambient );
-            glUniform4fv( dloc, 1, cyl_diffuse );
+            sendVec4( ambientColorU, cyl_ambient );
+            sendVec4( diffuseColorU, cyl_diffuse );
             break;
         case OBJ_SPHERE:
-            glUniform4fv( aloc, 1, sph_ambient );
-            glUniform4fv( dloc, 1, sph_diffuse );
+            sendVec4( ambientColorU, sph_ambient );
+            sendVec4( diffuseColorU, sph_diffuse );
             break;
         }
     }
     else {
         // if using texture mapping
-        GLint loc_f = glGetUniformLocation(program, "tex_f");
-        GLint loc_b = glGetUniformLocation(program, "tex_b");
-        
         switch( obj ) {
         case OBJ_QUAD:
-            glUniform1i(loc_f, 0);
-            glUniform1i(loc_b, 1);
+            sendInt(texFrontU, 0);
+            sendInt(texBackU, 1);
             break;
         case OBJ_CYLINDER:
-            glUniform1i(loc_f, 2);
+            sendInt(texFrontU, 2);
             break;
         case OBJ_DISCS:
-            glUniform1i(loc_f, 3);
+            sendInt(texFrontU, 3);
             break;
         case OBJ_SPHERE:
-            glUniform1i(loc_f, 4);
+            sendInt(texFrontU, 4);
             break;
         }
     }
+
+    return( program );
 }
@@ -30,6 +30,9 @@
 // Are we doing texture mapping instead of material properties?
 extern bool usingTextures;
 
+// How is lighting done:  0 (Phong), SV_FLAT, or SV_GOURAUD?
+extern unsigned int shading;
+
 ///
 /// This function initializes all texture-related data structures for
 /// the program.  This is where texture buffers should be created, where
@@ -43,13 +46,18 @@ void initTextures( void );
 ///
 /// This function sets up the parameters for texture use.
 ///
+/// The shader variant (see ShaderVariants.h) that suits the object is
+/// selected, and the parameters are sent to it; the other parameters
+/// for the object must then be sent to the program returned.
+///
 /// You will need to write this function, and maintain all of the values
 /// needed to be sent to the various shaders.
 ///
-/// @param program The ID of an OpenGL (GLSL) shader program to which
-///    parameter values are to be sent
+/// @param program The ID of an OpenGL (GLSL) shader program to use if
+///    no variant can be had
 /// @param obj     The object type of the object being drawn
+/// @return the program now in use
 ///
-void setTextures( GLuint program, int obj );
+GLuint setTextures( GLuint program, int obj );
 
 #endif 
@@ -0,0 +1,415 @@
+///
+//  UniformBlocks.cpp
+//
+//  Uniform buffer objects for the camera, light, material, and object
+//  parameters
+//
+//  This file should not be modified by students.
+///
+
+#include <cstring>
+#include <vector>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#ifndef __APPLE__
+#include <GL/glew.h>
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include "UniformBlocks.h"
+#include "Backend.h"
+
+using namespace std;
+
+///
+/// PRIVATE GLOBALS
+///
+
+/// names of the blocks in the shaders, in UniformBlock order
+static const char *blockNames[N_UNIFORM_BLOCKS] = {
+    "Frame", "Light", "Material", "Object"
+};
+
+/// programs whose blocks have been connected to our binding points
+static vector<GLuint> blockPrograms;
+
+/// the buffers, one per block
+static GLuint buffers[N_UNIFORM_BLOCKS];
+
+/// distance between slots of the material and object buffers
+static GLsizeiptr materialStride, objectStride;
+
+/// slots allocated in those buffers
+static int materialCapacity, objectCapacity;
+
+/// the frame and light blocks, as filled in and as last uploaded
+static FrameBlock frame, frameSent;
+static LightBlock light, lightSent;
+static bool frameValid, lightValid;
+
+/// the distinct materials, in the order of their buffer slots, a hash
+/// of each, and the number of objects using each; slots no object uses
+/// are free to be filled with another material
+static vector<MaterialBlock> materials;
+static vector<unsigned int> materialHashes;
+static vector<int> materialRefs;
+
+/// each object's material and object blocks, the material slot it
+/// holds (or -1), and the object blocks as last uploaded
+static vector<MaterialBlock> objMaterials;
+static vector<int> objMaterialSlots;
+static vector<ObjectBlock> objects, objectsSent;
+static vector<bool> objectValid;
+
+/// the object being set up
+static int current;
+
+/// the ranges bound to the material and object binding points
+static int boundMaterial = -1, boundObject = -1;
+
+///
+/// PRIVATE FUNCTIONS
+///
+
+///
+/// stride(size) - round a block size up to the alignment required
+///     of uniform buffer ranges
+///
+static GLsizeiptr stride( size_t size ) {
+    GLint align = 0;
+
+    backend->getIntegerv( GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align );
+    if( align < 1 ) {
+        align = 256;    // the largest the spec allows
+    }
+
+    return( ((size + align - 1) / align) * align );
+}
+
+///
+/// makeBuffers() - create the four buffers, if they aren't there yet
+///
+static void makeBuffers( void ) {
+    if( buffers[UB_FRAME] != 0 ) {
+        return;
+    }
+
+    backend->genBuffers( N_UNIFORM_BLOCKS, buffers );
+
+    backend->bindBuffer( GL_UNIFORM_BUFFER, buffers[UB_FRAME] );
+    backend->bufferData( GL_UNIFORM_BUFFER, sizeof(FrameBlock), NULL,
+                         GL_DYNAMIC_DRAW );
+    backend->bindBuffer( GL_UNIFORM_BUFFER, buffers[UB_LIGHT] );
+    backend->bufferData( GL_UNIFORM_BUFFER, sizeof(LightBlock), NULL,
+                         GL_DYNAMIC_DRAW );
+
+    // the whole of these two blocks is always bound
+    backend->bindBufferBase( GL_UNIFORM_BUFFER, UB_FRAME, buffers[UB_FRAME] );
+    backend->bindBufferBase( GL_UNIFORM_BUFFER, UB_LIGHT, buffers[UB_LIGHT] );
+
+    materialStride = stride( sizeof(MaterialBlock) );
+    objectStride = stride( sizeof(ObjectBlock) );
+    materialCapacity = objectCapacity = 0;
+    frameValid = lightValid = false;
+}
+
+///
+/// growSlots(which,stride,capacity,need) - reallocate the material or
+///     object buffer with room for at least 'need' slots; its previous
+///     contents are lost
+///
+/// @return the new capacity
+///
+static int growSlots( UniformBlock which, GLsizeiptr stride,
+                      int capacity, int need ) {
+    int n = capacity > 0 ? capacity : 4;
+    while( n < need ) {
+        n *= 2;
+    }
+
+    backend->bindBuffer( GL_UNIFORM_BUFFER, buffers[which] );
+    backend->bufferData( GL_UNIFORM_BUFFER, n * stride, NULL,
+                         GL_DYNAMIC_DRAW );
+
+    return( n );
+}
+
+///
+/// upload(which,offset,data,size) - write into one of the buffers
+///
+static void upload( UniformBlock which, GLintptr offset,
+                    const void *data, GLsizeiptr size ) {
+    backend->bindBuffer( GL_UNIFORM_BUFFER, buffers[which] );
+    backend->bufferSubData( GL_UNIFORM_BUFFER, offset, size, data );
+}
+
+///
+/// hashMaterial(m) - hash a material block (FNV-1a over its bytes)
+///
+static unsigned int hashMaterial( const MaterialBlock &m ) {
+    const unsigned char *b = (const unsigned char *) &m;
+    unsigned int h = 2166136261u;
+
+    for( size_t i = 0; i < sizeof(m); ++i ) {
+        h = (h ^ b[i]) * 16777619u;
+    }
+
+    return( h );
+}
+
+///
+/// findMaterial(m) - find the slot holding a material, putting it in a
+///     free slot (or a new one) if it isn't there, and count one more
+///     user of that slot
+///
+/// @return the slot
+///
+static int findMaterial( const MaterialBlock &m ) {
+    unsigned int h = hashMaterial( m );
+    int slot = -1;
+
+    // a slot that already holds it, in use or not, needs no upload
+    for( size_t i = 0; i < materials.size(); ++i ) {
+        if( materialHashes[i] == h &&
+            memcmp( &materials[i], &m, sizeof(m) ) == 0 ) {
+            materialRefs[i]++;
+            return( (int) i );
+        }
+        if( slot < 0 && materialRefs[i] == 0 ) {
+            slot = (int) i;
+        }
+    }
+
+    if( slot >= 0 ) {
+        materials[slot] = m;
+        materialHashes[slot] = h;
+        materialRefs[slot] = 1;
+        upload( UB_MATERIAL, slot * materialStride, &m,
+                sizeof(MaterialBlock) );
+        return( slot );
+    }
+
+    slot = (int) materials.size();
+    materials.push_back( m );
+    materialHashes.push_back( h );
+    materialRefs.push_back( 1 );
+
+    if( slot >= materialCapacity ) {
+        materialCapacity = growSlots( UB_MATERIAL, materialStride,
+                                      materialCapacity, slot + 1 );
+        boundMaterial = -1;
+        for( size_t i = 0; i < materials.size(); ++i ) {
+            upload( UB_MATERIAL, i * materialStride, &materials[i],
+                    sizeof(MaterialBlock) );
+        }
+    } else {
+        upload( UB_MATERIAL, slot * materialStride, &m,
+                sizeof(MaterialBlock) );
+    }
+
+    return( slot );
+}
+
+///
+/// PUBLIC FUNCTIONS
+///
+
+///
+/// Can we use uniform buffer objects?
+///
+bool uniformBlocksAvailable( void ) {
+    return( backend->hasCapability( CAP_UNIFORM_BLOCKS ) );
+}
+
+///
+/// Connect a program's uniform blocks to our binding points
+///
+/// @param program  the shader program
+/// @return true if the program declares all of the blocks
+///
+bool bindUniformBlocks( GLuint program ) {
+    GLuint index[N_UNIFORM_BLOCKS];
+
+    for( int i = 0; i < N_UNIFORM_BLOCKS; ++i ) {
+        index[i] = backend->getUniformBlockIndex( program, blockNames[i] );
+        if( index[i] == GL_INVALID_INDEX ) {
+            return( false );
+        }
+    }
+
+    for( int i = 0; i < N_UNIFORM_BLOCKS; ++i ) {
+        backend->uniformBlockBinding( program, index[i], i );
+    }
+
+    if( !usesUniformBlocks( program ) ) {
+        blockPrograms.push_back( program );
+    }
+
+    return( true );
+}
+
+///
+/// Does a program take its parameters from the uniform blocks?
+///
+bool usesUniformBlocks( GLuint program ) {
+    for( size_t i = 0; i < blockPrograms.size(); ++i ) {
+        if( blockPrograms[i] == program ) {
+            return( true );
+        }
+    }
+    return( false );
+}
+
+///
+/// Forget that a program's blocks were connected
+///
+void forgetUniformBlocks( GLuint program ) {
+    for( size_t i = 0; i < blockPrograms.size(); ++i ) {
+        if( blockPrograms[i] == program ) {
+            blockPrograms.erase( blockPrograms.begin() + i );
+            return;
+        }
+    }
+}
+
+///
+/// Get the blocks to be filled in
+///
+FrameBlock *frameBlock( void ) {
+    return( &frame );
+}
+
+LightBlock *lightBlock( void ) {
+    return( &light );
+}
+
+MaterialBlock *materialBlock( void ) {
+    selectObject( current );
+    return( &objMaterials[current] );
+}
+
+ObjectBlock *objectBlock( void ) {
+    selectObject( current );
+    return( &objects[current] );
+}
+
+///
+/// Choose the object whose blocks are to be filled in and committed
+///
+/// @param slot  the object's number (0, 1, ...)
+///
+void selectObject( int slot ) {
+    if( slot < 0 ) {
+        slot = 0;
+    }
+
+    if( slot >= (int) objects.size() ) {
+        MaterialBlock m;
+        ObjectBlock o;
+
+        // the padding must be zero, as the blocks are compared whole
+        memset( &m, 0, sizeof(m) );
+        memset( &o, 0, sizeof(o) );
+        objMaterials.resize( slot + 1, m );
+        objMaterialSlots.resize( slot + 1, -1 );
+        objects.resize( slot + 1, o );
+        objectsSent.resize( slot + 1, o );
+        objectValid.resize( slot + 1, false );
+    }
+
+    current = slot;
+}
+
+///
+/// Upload whatever has changed, and bind the current object's ranges
+///
+void commitBlocks( void ) {
+    makeBuffers();
+    selectObject( current );
+
+    if( !frameValid || memcmp( &frame, &frameSent, sizeof(frame) ) != 0 ) {
+        upload( UB_FRAME, 0, &frame, sizeof(frame) );
+        frameSent = frame;
+        frameValid = true;
+    }
+
+    if( !lightValid || memcmp( &light, &lightSent, sizeof(light) ) != 0 ) {
+        upload( UB_LIGHT, 0, &light, sizeof(light) );
+        lightSent = light;
+        lightValid = true;
+    }
+
+    // objects with the same material share its slot; an object keeps
+    // its slot until its material changes, when it gives that slot up
+    // (so it can be reused) before looking for the new one
+    int m = objMaterialSlots[current];
+    if( m < 0 || memcmp( &materials[m], &objMaterials[current],
+                         sizeof(MaterialBlock) ) != 0 ) {
+        if( m >= 0 ) {
+            materialRefs[m]--;
+        }
+        m = findMaterial( objMaterials[current] );
+        objMaterialSlots[current] = m;
+    }
+    if( m != boundMaterial ) {
+        backend->bindBufferRange( GL_UNIFORM_BUFFER, UB_MATERIAL,
+                                  buffers[UB_MATERIAL], m * materialStride,
+                                  sizeof(MaterialBlock) );
+        boundMaterial = m;
+    }
+
+    // a new slot means a new buffer, which must be filled again
+    if( current >= objectCapacity ) {
+        objectCapacity = growSlots( UB_OBJECT, objectStride,
+                                    objectCapacity, current + 1 );
+        boundObject = -1;
+        for( size_t i = 0; i < objectValid.size(); ++i ) {
+            objectValid[i] = false;
+        }
+    }
+
+    if( !objectValid[current] ||
+        memcmp( &objects[current], &objectsSent[current],
+                sizeof(ObjectBlock) ) != 0 ) {
+        upload( UB_OBJECT, current * objectStride, &objects[current],
+                sizeof(ObjectBlock) );
+        objectsSent[current] = objects[current];
+        objectValid[current] = true;
+    }
+
+    if( current != boundObject ) {
+        backend->bindBufferRange( GL_UNIFORM_BUFFER, UB_OBJECT,
+                                  buffers[UB_OBJECT],
+                                  current * objectStride,
+                                  sizeof(ObjectBlock) );
+        boundObject = current;
+    }
+}
+
+///
+/// Delete the buffers and forget all the blocks
+///
+void releaseUniformBlocks( void ) {
+    if( buffers[UB_FRAME] != 0 ) {
+        backend->deleteBuffers( N_UNIFORM_BLOCKS, buffers );
+        memset( buffers, 0, sizeof(buffers) );
+    }
+
+    materials.clear();
+    materialHashes.clear();
+    materialRefs.clear();
+    objMaterials.clear();
+    objMaterialSlots.clear();
+    objects.clear();
+    objectsSent.clear();
+    objectValid.clear();
+    blockPrograms.clear();
+    current = 0;
+    boundMaterial = boundObject = -1;
+    materialCapacity = objectCapacity = 0;
+    frameValid = lightValid = false;
+}
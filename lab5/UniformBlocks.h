@@ -0,0 +1,166 @@
+///
+//  UniformBlocks.h
+//
+//  Uniform buffer objects for the camera, light, material, and object
+//  parameters
+//
+//  Instead of sending each parameter with its own glUniform*() call,
+//  the modules that set them up write them into the std140 blocks
+//  below; commitBlocks() then uploads whatever changed and binds the
+//  ranges for the object about to be drawn.  The frame and light blocks
+//  are uploaded only when they change; identical materials share one
+//  slot of the material buffer, which is reused once no object has that
+//  material; and each object has its own slot of the object buffer, so
+//  drawing an object that didn't change costs no more than binding its
+//  ranges.
+//
+//  The shaders declare the blocks as
+//
+//     layout(std140) uniform Frame    { ... };
+//     layout(std140) uniform Light    { ... };
+//     layout(std140) uniform Material { ... };
+//     layout(std140) uniform Object   { ... };
+//
+//  with members matching the structures here, in the same order.
+//
+//  This code can be compiled as either C or C++.
+//
+//  This file should not be modified by students.
+///
+
+#ifndef _UNIFORMBLOCKS_H_
+#define _UNIFORMBLOCKS_H_
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#ifndef __APPLE__
+#include <GL/glew.h>
+#endif
+
+#include <GLFW/glfw3.h>
+
+#ifndef __cplusplus
+#include <stdbool.h>
+#endif
+
+///
+/// The blocks, and the binding point each one uses
+///
+typedef enum ublock_e {
+    UB_FRAME = 0, UB_LIGHT, UB_MATERIAL, UB_OBJECT,
+    // must be last
+    N_UNIFORM_BLOCKS
+} UniformBlock;
+
+///
+/// Camera and projection, set once per frame
+///
+typedef struct st_frameblock {
+    GLfloat pMat[16];           /// projection
+    GLfloat vMat[16];           /// view (camera)
+} FrameBlock;
+
+///
+/// The light source
+///
+typedef struct st_lightblock {
+    GLfloat lightPosition[4];   /// in world space
+    GLfloat lightColor[4];
+    GLfloat ambientLight[4];
+} LightBlock;
+
+///
+/// Material properties
+///
+/// std140 rounds the vec3 up to 16 bytes, but lets the float that
+/// follows it use the last four; the bool takes four bytes, and the
+/// block is padded to a multiple of 16.
+///
+typedef struct st_materialblock {
+    GLfloat ambientColor[4];
+    GLfloat diffuseColor[4];
+    GLfloat specularColor[4];
+    GLfloat kCoeff[3];          /// ambient, diffuse, specular
+    GLfloat specExp;
+    GLint usingTextures;        /// a GLSL bool
+    GLint pad[3];
+} MaterialBlock;
+
+///
+/// Model transformations and vertex data decoding for one object
+///
+typedef struct st_objectblock {
+    GLfloat mvMat[16];          /// model-view
+    GLfloat nMat[16];           /// normal (in the upper left 3x3)
+    GLfloat uvTransform[4];     /// (scale u, scale v, bias u, bias v)
+    GLint packedNormals;        /// a GLSL bool
+    GLint pad[3];
+} ObjectBlock;
+
+///
+/// Can we use uniform buffer objects?
+///
+/// @return true if the backend has them (with OpenGL, if 3.1 or
+///         GL_ARB_uniform_buffer_object is there)
+///
+bool uniformBlocksAvailable( void );
+
+///
+/// Connect a program's uniform blocks to our binding points; must be
+/// done each time the program is linked (or loaded)
+///
+/// @param program  the shader program
+/// @return true if the program declares all of the blocks
+///
+bool bindUniformBlocks( GLuint program );
+
+///
+/// Does a program take its parameters from the uniform blocks?
+///
+/// @param program  the shader program
+/// @return true if bindUniformBlocks() succeeded for it
+///
+bool usesUniformBlocks( GLuint program );
+
+///
+/// Forget that a program's blocks were connected; must be done when the
+/// program is deleted, as its name may be given to a new one
+///
+/// @param program  the shader program
+///
+void forgetUniformBlocks( GLuint program );
+
+///
+/// Get the blocks to be filled in.  The frame and light blocks are
+/// shared by all objects; the material and object blocks are those of
+/// the object chosen by selectObject().
+///
+/// @return the block
+///
+FrameBlock *frameBlock( void );
+LightBlock *lightBlock( void );
+MaterialBlock *materialBlock( void );
+ObjectBlock *objectBlock( void );
+
+///
+/// Choose the object whose material and object blocks are to be
+/// filled in and committed
+///
+/// @param slot  the object's number (0, 1, ...)
+///
+void selectObject( int slot );
+
+///
+/// Upload whatever has changed in the blocks, and bind the ranges that
+/// hold the current object's material and object blocks
+///
+void commitBlocks( void );
+
+///
+/// Delete the buffers and forget all the blocks
+///
+void releaseUniformBlocks( void );
+
+#endif
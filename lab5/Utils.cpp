@@ -16,6 +16,9 @@
 #include <cstdlib>
 // wimp out and use stdio
 #include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
 
 #if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
@@ -28,9 +31,27 @@
 #include <GLFW/glfw3.h>
 
 #include "Utils.h"
+#include "UniformBlocks.h"
+#include "Backend.h"
 
 using namespace std;
 
+///
+/// One active uniform variable of a program
+///
+typedef struct st_uniforminfo {
+    GLint loc;      /// its location
+    GLenum type;    /// its type (GL_NONE if not reflected)
+} UniformInfo;
+
+///
+/// The reflected uniforms of each program, by name
+///
+static map< GLuint, map<string,UniformInfo> > uniformTables;
+
+/// the number of programs released
+static unsigned long released;
+
 ///
 /// OpenGL error checking
 ///
@@ -45,7 +66,7 @@ void checkErrors( const char *msg ) {
     GLenum code;
     const char *str;
 
-    while( (code = glGetError()) != GL_NO_ERROR ) {
+    while( (code = backend->getError()) != GL_NO_ERROR ) {
         fprintf( stderr, "*** %s, GL error code 0x%x: ", msg, code );
         switch( code ) {
         case GL_INVALID_ENUM:
@@ -154,24 +175,24 @@ void dumpActives( GLuint program ) {
     const GLsizei bufSize = 32;
     GLchar name[bufSize];
 
-    glGetProgramiv( program, GL_ACTIVE_ATTRIBUTES, &count );
+    backend->getProgramiv( program, GL_ACTIVE_ATTRIBUTES, &count );
     if( count < 1 ) {
          fputs( "No ", stderr );
     }
     fputs( "Active attributes\n", stderr );
     for( i = 0; i < count; ++i ) {
-        glGetActiveAttrib( program, i, bufSize, &length, &size, &type, name );
+        backend->getActiveAttrib( program, i, bufSize, &length, &size, &type, name );
         fprintf( stderr, "  #%u Type: %s Name: '%s'\n",
             i, type2str(type), name );
     }
 
-    glGetProgramiv( program, GL_ACTIVE_UNIFORMS, &count );
+    backend->getProgramiv( program, GL_ACTIVE_UNIFORMS, &count );
     if( count < 1 ) {
          fputs( "No ", stderr );
     }
     fputs( "Active uniforms\n", stderr );
     for( i = 0; i < count; ++i ) {
-        glGetActiveUniform( program, i, bufSize, &length, &size, &type, name );
+        backend->getActiveUniform( program, i, bufSize, &length, &size, &type, name );
         fprintf( stderr, "  #%u Type: %s Name: '%s'\n",
             i, type2str(type), name );
     }
@@ -186,7 +207,7 @@ void dumpActives( GLuint program ) {
 GLint getUniformLoc( GLuint program, const GLchar *name ) {
     GLint loc;
 
-    loc = glGetUniformLocation( program, name );
+    loc = backend->getUniformLocation( program, name );
     if( loc < 0 ) {
         fprintf( stderr, "Bad uniform, program %u variable '%s'\n",
             program, name );
@@ -204,7 +225,7 @@ GLint getUniformLoc( GLuint program, const GLchar *name ) {
 GLint getAttribLoc( GLuint program, const GLchar *name ) {
     GLint loc;
 
-    loc = glGetAttribLocation( program, name );
+    loc = backend->getAttribLocation( program, name );
     if( loc < 0 ) {
         fprintf( stderr, "Bad attribute, program %u variable '%s'\n",
             program, name );
@@ -212,3 +233,206 @@ GLint getAttribLoc( GLuint program, const GLchar *name ) {
 
     return( loc );
 }
+
+///
+/// Build (or rebuild) the table of a program's active uniforms
+///
+/// @param program  the shader program, just linked
+///
+void reflectUniforms( GLuint program ) {
+    map<string,UniformInfo> &table = uniformTables[program];
+    GLint count = 0, maxLength = 0;
+
+    table.clear();
+
+    backend->getProgramiv( program, GL_ACTIVE_UNIFORMS, &count );
+    backend->getProgramiv( program, GL_ACTIVE_UNIFORM_MAX_LENGTH,
+                           &maxLength );
+    if( count < 1 || maxLength < 1 ) {
+        return;
+    }
+
+    GLchar *name = new GLchar[ maxLength ];
+    for( GLint i = 0; i < count; ++i ) {
+        GLsizei length = 0;
+        GLint size;
+        GLenum type;
+
+        backend->getActiveUniform( program, i, maxLength, &length,
+                                   &size, &type, name );
+        if( length < 1 ) {
+            continue;
+        }
+
+        UniformInfo info;
+        info.loc = backend->getUniformLocation( program, name );
+        info.type = type;
+
+        // arrays are reported as "name[0]", but we look them up as "name"
+        string key( name, length );
+        if( key.size() > 3 && key.compare( key.size() - 3, 3, "[0]" ) == 0 ) {
+            key.erase( key.size() - 3 );
+        }
+        table[key] = info;
+    }
+    delete [] name;
+}
+
+///
+/// Delete a program, and forget everything noted about it
+///
+/// @param program  the shader program
+///
+void releaseProgram( GLuint program ) {
+    forgetUniformBlocks( program );
+    uniformTables.erase( program );
+    backend->deleteProgram( program );
+    released++;
+}
+
+///
+/// How many programs have been released so far
+///
+unsigned long programsReleased( void ) {
+    return( released );
+}
+
+///
+/// Is a cache still good for a program?
+///
+/// @param key      the cache's key
+/// @param program  the program about to be used
+/// @return         true if the cache can be used as it is
+///
+bool checkProgram( ProgramKey *key, GLuint program ) {
+    if( key->program == program && key->released == released ) {
+        return( true );
+    }
+
+    key->program = program;
+    key->released = released;
+    return( false );
+}
+
+///
+/// findUniform(program,name,want,type) - look up a uniform variable
+///     and verify its type
+///
+/// A program that wasn't reflected is reflected now; a name that isn't
+/// in the table is looked up the old way, and its type isn't checked.
+/// A name the program doesn't have quietly gets location -1 (which the
+/// uniform calls ignore), since a shader variant need not use them all.
+///
+/// @param program  the shader program
+/// @param name     the name of the desired variable
+/// @param want     the type needed, for messages
+/// @param types    the acceptable types, ending with GL_NONE
+/// @return         the location
+///
+static GLint findUniform( GLuint program, const GLchar *name,
+                          const char *want, const GLenum *types ) {
+    if( uniformTables.find( program ) == uniformTables.end() ) {
+        reflectUniforms( program );
+    }
+
+    map<string,UniformInfo> &table = uniformTables[program];
+    map<string,UniformInfo>::iterator it = table.find( name );
+    if( it == table.end() ) {
+        UniformInfo info;
+        info.loc = backend->getUniformLocation( program, name );
+        info.type = GL_NONE;
+        table[name] = info;
+        return( info.loc );
+    }
+
+    if( it->second.type == GL_NONE ) {
+        return( it->second.loc );
+    }
+
+    for( int i = 0; types[i] != GL_NONE; ++i ) {
+        if( it->second.type == types[i] ) {
+            return( it->second.loc );
+        }
+    }
+
+    fprintf( stderr, "Uniform '%s' in program %u is %s, not %s\n",
+        name, program, type2str( it->second.type ), want );
+    return( -1 );
+}
+
+///
+/// Look up a uniform variable's handle, and verify its type
+///
+/// @param program  the shader program
+/// @param name     the name of the desired variable
+/// @return         the handle
+///
+UniformMat4 uniformMat4( GLuint program, const GLchar *name ) {
+    static const GLenum types[] = { GL_FLOAT_MAT4, GL_NONE };
+    UniformMat4 u = { findUniform( program, name, "mat4", types ) };
+    return( u );
+}
+
+UniformVec4 uniformVec4( GLuint program, const GLchar *name ) {
+    static const GLenum types[] = { GL_FLOAT_VEC4, GL_NONE };
+    UniformVec4 u = { findUniform( program, name, "vec4", types ) };
+    return( u );
+}
+
+UniformVec3 uniformVec3( GLuint program, const GLchar *name ) {
+    static const GLenum types[] = { GL_FLOAT_VEC3, GL_NONE };
+    UniformVec3 u = { findUniform( program, name, "vec3", types ) };
+    return( u );
+}
+
+UniformFloat uniformFloat( GLuint program, const GLchar *name ) {
+    static const GLenum types[] = { GL_FLOAT, GL_NONE };
+    UniformFloat u = { findUniform( program, name, "float", types ) };
+    return( u );
+}
+
+UniformInt uniformInt( GLuint program, const GLchar *name ) {
+    static const GLenum types[] = {
+        GL_INT, GL_BOOL, GL_SAMPLER_1D, GL_SAMPLER_2D, GL_SAMPLER_3D,
+        GL_SAMPLER_CUBE, GL_NONE
+    };
+    UniformInt u = { findUniform( program, name,
+                                  "int, bool, or sampler", types ) };
+    return( u );
+}
+
+///
+/// Send a value to a uniform variable of the current program
+///
+/// @param u      the variable's handle
+/// @param value  the value to send
+///
+void sendMat4( UniformMat4 u, const GLfloat *value ) {
+    if( u.loc >= 0 ) {
+        backend->uniformMatrix4fv( u.loc, 1, GL_FALSE, value );
+    }
+}
+
+void sendVec4( UniformVec4 u, const GLfloat *value ) {
+    if( u.loc >= 0 ) {
+        backend->uniform4fv( u.loc, 1, value );
+    }
+}
+
+void sendVec3( UniformVec3 u, const GLfloat *value ) {
+    if( u.loc >= 0 ) {
+        backend->uniform3fv( u.loc, 1, value );
+    }
+}
+
+void sendFloat( UniformFloat u, GLfloat value ) {
+    if( u.loc >= 0 ) {
+        backend->uniform1f( u.loc, value );
+    }
+}
+
+void sendInt( UniformInt u, GLint value ) {
+    if( u.loc >= 0 ) {
+        backend->uniform1i( u.loc, value );
+    }
+}
@@ -70,4 +70,90 @@ GLint getUniformLoc( GLuint program, const GLchar *name );
 ///
 GLint getAttribLoc( GLuint program, const GLchar *name );
 
+///
+/// Uniform variable handles
+///
+/// A program's active uniforms are reflected once, after it has been
+/// linked, into a table; handles are then looked up in that table
+/// rather than by asking the driver, and are meant to be looked up
+/// once and kept.  The type of a handle says what can be sent to it.
+/// A handle for a missing uniform has location -1, and sending to it
+/// does nothing.
+///
+
+typedef struct st_umat4  { GLint loc; } UniformMat4;   /// mat4
+typedef struct st_uvec4  { GLint loc; } UniformVec4;   /// vec4
+typedef struct st_uvec3  { GLint loc; } UniformVec3;   /// vec3
+typedef struct st_ufloat { GLint loc; } UniformFloat;  /// float
+typedef struct st_uint   { GLint loc; } UniformInt;    /// int, bool, sampler
+
+///
+/// Build (or rebuild) the table of a program's active uniforms
+///
+/// @param program  the shader program, just linked
+///
+void reflectUniforms( GLuint program );
+
+///
+/// Delete a program, and forget everything noted about it:  its table
+/// of uniforms and its uniform block connections here, and (through
+/// programsReleased()) the handles and vertex array objects other
+/// modules keep for it.  OpenGL may give its name to a new program.
+///
+/// @param program  the shader program
+///
+void releaseProgram( GLuint program );
+
+///
+/// How many programs have been released so far
+///
+/// @return the count
+///
+unsigned long programsReleased( void );
+
+///
+/// What a cache of things looked up in a program remembers about it
+///
+typedef struct st_programkey {
+    GLuint program;         /// the program the cache was filled for
+    unsigned long released; /// programsReleased() at that time
+} ProgramKey;
+
+///
+/// Is a cache still good for a program?  It isn't if it was filled for
+/// another program, or if any program has been released since then
+/// (which may have been this one, its name now reused).  If not, the
+/// key is set for the program, and the caller should fill the cache.
+///
+/// @param key      the cache's key
+/// @param program  the program about to be used
+/// @return         true if the cache can be used as it is
+///
+bool checkProgram( ProgramKey *key, GLuint program );
+
+///
+/// Look up a uniform variable's handle, and verify its type
+///
+/// @param program  the shader program
+/// @param name     the name of the desired variable
+/// @return         the handle
+///
+UniformMat4  uniformMat4( GLuint program, const GLchar *name );
+UniformVec4  uniformVec4( GLuint program, const GLchar *name );
+UniformVec3  uniformVec3( GLuint program, const GLchar *name );
+UniformFloat uniformFloat( GLuint program, const GLchar *name );
+UniformInt   uniformInt( GLuint program, const GLchar *name );
+
+///
+/// Send a value to a uniform variable of the current program
+///
+/// @param u      the variable's handle
+/// @param value  the value to send
+///
+void sendMat4( UniformMat4 u, const GLfloat *value );
+void sendVec4( UniformVec4 u, const GLfloat *value );
+void sendVec3( UniformVec3 u, const GLfloat *value );
+void sendFloat( UniformFloat u, GLfloat value );
+void sendInt( UniformInt u, GLint value );
+
 #endif
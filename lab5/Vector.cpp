@@ -20,6 +20,10 @@
 
 #include "Vector.h"
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
 using namespace std;
 
 /////////////////////////////////
@@ -114,3 +118,88 @@ void norm( Vector result, const Vector vec ) {
         result[VX] = result[VY] = result[VZ] = 0.0f;
     }
 }
+
+///
+/// Compute the unit surface normals of a batch of triangles
+///
+/// @param result  the n normals, three floats each
+/// @param pos     the 3n vertices, each beginning with its XYZ
+/// @param stride  bytes from one vertex to the next
+/// @param n       the number of triangles
+///
+void faceNormals( float *result, const float *pos, size_t stride, int n ) {
+    const char *base = (const char *) pos;
+    int i = 0;
+
+    // fetch component c of vertex v
+#define P(v,c)  (((const float *) (base + (v) * stride))[c])
+
+#ifdef __SSE__
+    // four triangles at a time, one per lane.  Each vertex is loaded
+    // whole (XYZ and one more float, so the vertices must be at least
+    // four floats apart), and each corner's four vertices transposed
+    // into X, Y, Z, and W registers; the edges are then differences
+    // of whole registers
+#define L(v)    _mm_loadu_ps( (const float *) (base + (v) * stride) )
+    const __m128 zero = _mm_setzero_ps();
+    for( ; stride >= 4 * sizeof(float) && i + 4 <= n; i += 4 ) {
+        int v = i * 3;
+        __m128 x0 = L(v),   y0 = L(v+3), z0 = L(v+6),  w0 = L(v+9);
+        __m128 x1 = L(v+1), y1 = L(v+4), z1 = L(v+7),  w1 = L(v+10);
+        __m128 x2 = L(v+2), y2 = L(v+5), z2 = L(v+8),  w2 = L(v+11);
+        _MM_TRANSPOSE4_PS( x0, y0, z0, w0 );
+        _MM_TRANSPOSE4_PS( x1, y1, z1, w1 );
+        _MM_TRANSPOSE4_PS( x2, y2, z2, w2 );
+
+        __m128 ux = _mm_sub_ps( x1, x0 );
+        __m128 uy = _mm_sub_ps( y1, y0 );
+        __m128 uz = _mm_sub_ps( z1, z0 );
+        __m128 wx = _mm_sub_ps( x2, x0 );
+        __m128 wy = _mm_sub_ps( y2, y0 );
+        __m128 wz = _mm_sub_ps( z2, z0 );
+
+        // u x w
+        __m128 nx = _mm_sub_ps( _mm_mul_ps(uy, wz), _mm_mul_ps(uz, wy) );
+        __m128 ny = _mm_sub_ps( _mm_mul_ps(uz, wx), _mm_mul_ps(ux, wz) );
+        __m128 nz = _mm_sub_ps( _mm_mul_ps(ux, wy), _mm_mul_ps(uy, wx) );
+
+        // divide by the exact length; lanes with zero length come
+        // out as NaN from the division, and are masked to zero
+        __m128 len2 = _mm_add_ps( _mm_add_ps( _mm_mul_ps(nx, nx),
+                          _mm_mul_ps(ny, ny) ), _mm_mul_ps(nz, nz) );
+        __m128 ok = _mm_cmpgt_ps( len2, zero );
+        __m128 len = _mm_sqrt_ps( len2 );
+        nx = _mm_and_ps( ok, _mm_div_ps(nx, len) );
+        ny = _mm_and_ps( ok, _mm_div_ps(ny, len) );
+        nz = _mm_and_ps( ok, _mm_div_ps(nz, len) );
+
+        // back to XYZ order; each store spills one float into the
+        // next normal, which the following store overwrites, so the
+        // last one goes through a temporary
+        __m128 pad = zero;
+        _MM_TRANSPOSE4_PS( nx, ny, nz, pad );
+        float last[4];
+        _mm_storeu_ps( result + i*3, nx );
+        _mm_storeu_ps( result + i*3 + 3, ny );
+        _mm_storeu_ps( result + i*3 + 6, nz );
+        _mm_storeu_ps( last, pad );
+        result[i*3 + 9 + VX] = last[VX];
+        result[i*3 + 9 + VY] = last[VY];
+        result[i*3 + 9 + VZ] = last[VZ];
+    }
+#undef L
+#endif
+
+    // whatever is left over, one at a time
+    for( ; i < n; ++i ) {
+        int v = i * 3;
+        Vector u = { P(v+1,0) - P(v,0), P(v+1,1) - P(v,1), P(v+1,2) - P(v,2) };
+        Vector w = { P(v+2,0) - P(v,0), P(v+2,1) - P(v,1), P(v+2,2) - P(v,2) };
+        Vector c;
+
+        cross( c, u, w );
+        norm( result + i*3, c );
+    }
+
+#undef P
+}
@@ -93,4 +93,20 @@ float mag( const Vector vec );
 ///
 void norm( Vector result, const Vector vec );
 
+///
+/// Compute the unit surface normals of a batch of triangles
+///
+/// Triangle i has vertices 3i, 3i+1, and 3i+2, and its normal is the
+/// normalized cross product (p1 - p0) x (p2 - p0), or a zero vector
+/// for a degenerate triangle.  Where SSE is available, and the vertices
+/// are at least four floats apart, four triangles are processed at a
+/// time.
+///
+/// @param result  the n normals, three floats each
+/// @param pos     the 3n vertices, each beginning with its XYZ
+/// @param stride  bytes from one vertex to the next
+/// @param n       the number of triangles
+///
+void faceNormals( float *result, const float *pos, size_t stride, int n );
+
 #endif
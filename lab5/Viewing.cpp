@@ -33,6 +33,7 @@
 #include "Viewing.h"
 #include "Vector.h"
 #include "Utils.h"
+#include "UniformBlocks.h"
 
 #ifdef __cplusplus
 using namespace std;
@@ -62,6 +63,32 @@ static GLfloat bounds[] = { -1.0f, 1.0f, 1.0f, -1.0f, 3.0f, 100.5f };
 #define NEAR	bounds[4]
 #define FAR	bounds[5]
 
+// handles of the uniform variables we use, and the program they're in
+static ProgramKey uProgram;
+static UniformMat4 pMatU, vMatU, mvMatU, nMatU;
+
+// the most recent camera matrix, for composing the model-view matrix
+static GLfloat viewMat[16];
+static int haveView = 0;
+
+///
+// Look up the handles of our uniform variables in a program, unless
+// they were already looked up in it.
+//
+// @param program - The ID of an OpenGL (GLSL) shader program
+///
+static void findUniforms( GLuint program )
+{
+    if( checkProgram( &uProgram, program ) ) {
+        return;
+    }
+
+    pMatU = uniformMat4( program, "pMat" );
+    vMatU = uniformMat4( program, "vMat" );
+    mvMatU = uniformMat4( program, "mvMat" );
+    nMatU = uniformMat4( program, "nMat" );
+}
+
 ///
 // This function sets up a frustum projection of the scene.
 //
@@ -82,8 +109,141 @@ void setFrustum( GLuint program )
 	0.0f, 0.0f, (-2.0f * FAR * NEAR) / (FAR - NEAR), 0.0f
     };
 
-    GLint loc = getUniformLoc( program, "pMat" );
-    glUniformMatrix4fv( loc, 1, GL_FALSE, pmat );
+    if( usesUniformBlocks( program ) ) {
+        memcpy( frameBlock()->pMat, pmat, sizeof(pmat) );
+        return;
+    }
+
+    findUniforms( program );
+    sendMat4( pMatU, pmat );
+}
+
+///
+// Multiply two 4x4 matrices, all in column-major order: r = a * b.
+// r must not be a or b.
+///
+static void mult4( GLfloat r[16], const GLfloat a[16], const GLfloat b[16] )
+{
+    int row, col, i;
+
+    for( col = 0; col < 4; ++col ) {
+        for( row = 0; row < 4; ++row ) {
+            GLfloat sum = 0.0f;
+            for( i = 0; i < 4; ++i ) {
+                sum += a[i * 4 + row] * b[col * 4 + i];
+            }
+            r[col * 4 + row] = sum;
+        }
+    }
+}
+
+///
+// Compute the normal matrix for a model-view matrix:  the inverse
+// transpose of its upper-left 3x3 submatrix, which is the matrix of
+// cofactors divided by the determinant.  It is returned in the upper
+// left of a 4x4 matrix, so that it can be sent the same way as the
+// others.
+//
+// @param n  - the normal matrix
+// @param m  - the model-view matrix
+///
+static void normalMatrix( GLfloat n[16], const GLfloat m[16] )
+{
+// element (row r, column c) of m
+#define M(r,c)	m[(c) * 4 + (r)]
+
+    GLfloat c00 = M(1,1) * M(2,2) - M(1,2) * M(2,1);
+    GLfloat c01 = M(1,2) * M(2,0) - M(1,0) * M(2,2);
+    GLfloat c02 = M(1,0) * M(2,1) - M(1,1) * M(2,0);
+    GLfloat c10 = M(0,2) * M(2,1) - M(0,1) * M(2,2);
+    GLfloat c11 = M(0,0) * M(2,2) - M(0,2) * M(2,0);
+    GLfloat c12 = M(0,1) * M(2,0) - M(0,0) * M(2,1);
+    GLfloat c20 = M(0,1) * M(1,2) - M(0,2) * M(1,1);
+    GLfloat c21 = M(0,2) * M(1,0) - M(0,0) * M(1,2);
+    GLfloat c22 = M(0,0) * M(1,1) - M(0,1) * M(1,0);
+
+    GLfloat det = M(0,0) * c00 + M(0,1) * c01 + M(0,2) * c02;
+    GLfloat inv = det != 0.0f ? 1.0f / det : 0.0f;
+
+#undef M
+
+    // cofactor (r,c) goes in row r, column c
+    GLfloat nmat[16] = {
+	// column 0
+	c00 * inv, c10 * inv, c20 * inv, 0.0f,
+	// column 1
+	c01 * inv, c11 * inv, c21 * inv, 0.0f,
+	// column 2
+	c02 * inv, c12 * inv, c22 * inv, 0.0f,
+	// column 3
+	0.0f, 0.0f, 0.0f, 1.0f
+    };
+
+    memcpy( n, nmat, sizeof(nmat) );
+}
+
+///
+// Compute the camera (view) matrix.
+//
+// @param vmat - the matrix, in column-major order
+///
+static void makeCamera( GLfloat vmat[16] )
+{
+    ///
+    // Begin by calculating the axes of the camera coordinate system
+    ///
+
+    // calculate N
+    Vector tmp = { eye[0] - lookat[0], eye[1] - lookat[1], eye[2] - lookat[2] };
+
+    // normalize it
+    Vector N;
+    norm( N, tmp );
+
+    // calculate U
+    Vector U, uvec;
+
+    // convert 'up' to a Vector
+    uvec[0] = up[0];
+    uvec[1] = up[1];
+    uvec[2] = up[2];
+
+    norm( tmp, uvec );      // normalize 'up'
+    cross( uvec, tmp, N );  // cross 'up' with 'N'
+    norm( U, uvec );       // normalize the result
+
+    // calculate V
+    Vector V;
+
+    cross( tmp, N, U );
+    norm( V, tmp );
+
+    ///
+    // Next, create the camera matrix
+    ///
+
+    // convert eye to vector form
+    Vector evec;
+    memcpy( evec, eye, 3 * sizeof(GLfloat) );
+
+    // compute the dot products
+    float dotue = -1.0f * dot( U, evec );
+    float dotve = -1.0f * dot( V, evec );
+    float dotne = -1.0f * dot( N, evec );
+
+    // create the matrix in column-major order
+    GLfloat m[16] = {
+	// column 0
+        U[0], V[0], N[0], 0.0f,
+	// column 1
+        U[1], V[1], N[1], 0.0f,
+	// column 2
+        U[2], V[2], N[2], 0.0f,
+	// column 3
+	dotue, dotve, dotne, 1.0f
+    };
+
+    memcpy( vmat, m, sizeof(m) );
 }
 
 ///
@@ -91,6 +251,12 @@ void setFrustum( GLuint program )
 // of the object.  The order of application is fixed: scaling, Z rotation,
 // Y rotation, X rotation, and then translation.
 //
+// The transformations are composed here, once per object, rather than
+// for every vertex in the shader:  the shader receives the model-view
+// matrix (mvMat) and the normal matrix (nMat, in the upper left 3x3 of
+// a mat4).  The view matrix is the one the
+// last setCamera() call made.
+//
 // @param program - The ID of an OpenGL (GLSL) shader program to which
 //    parameter values are to be sent
 // @param scale  - scale factors for each axis
@@ -118,9 +284,6 @@ xlate[0], xlate[1], xlate[2] );
 	xlate[0], xlate[1], xlate[2], 1.0f
     };
 
-    GLint loc = getUniformLoc( program, "tMat" );
-    glUniformMatrix4fv( loc, 1, GL_FALSE, tmat );
-
     GLfloat smat[16] = {
         scale[0], 0.0f, 0.0f, 0.0f,
 	0.0f, scale[1], 0.0f, 0.0f,
@@ -128,18 +291,11 @@ xlate[0], xlate[1], xlate[2] );
 	0.0f, 0.0f, 0.0f, 1.0f
     };
 
-    loc = getUniformLoc( program, "sMat" );
-    glUniformMatrix4fv( loc, 1, GL_FALSE, smat );
-
     // create the three rotation matrices
     float rads[3]    = { D2R(rotate[0]), D2R(rotate[1]), D2R(rotate[2]) };
     float cosines[3] = { cos(rads[0]), cos(rads[1]), cos(rads[2]) };
     float sines[3]   = { sin(rads[0]), sin(rads[1]), sin(rads[2]) };
 
-    //float radx =D2R(rotate[0]), rady = D2R(rotate[1]), radz = D2R(rotate[2]);
-    //float sinx = sin(radx), siny = sin(rady), sinz = sin(radz);
-    //float cosx = cos(radx), cosy = cos(rady), cosz = cos(radz);
-
     GLfloat xmat[16] = {
         1.0f, 0.0f, 0.0f, 0.0f,
 	0.0f, cosines[0], sines[0], 0.0f,
@@ -147,9 +303,6 @@ xlate[0], xlate[1], xlate[2] );
 	0.0f, 0.0f, 0.0f, 1.0f
     };
 
-    loc = getUniformLoc( program, "xMat" );
-    glUniformMatrix4fv( loc, 1, GL_FALSE, xmat );
-
     GLfloat ymat[16] = {
         cosines[1], 0.0f, -sines[1], 0.0f,
 	0.0f, 1.0f, 0.0f, 0.0f,
@@ -157,9 +310,6 @@ xlate[0], xlate[1], xlate[2] );
 	0.0f, 0.0f, 0.0f, 1.0f
     };
 
-    loc = getUniformLoc( program, "yMat" );
-    glUniformMatrix4fv( loc, 1, GL_FALSE, ymat );
-
     GLfloat zmat[16] = {
         cosines[2], sines[2], 0.0f, 0.0f,
 	-sines[2], cosines[2], 0.0f, 0.0f,
@@ -167,8 +317,33 @@ xlate[0], xlate[1], xlate[2] );
 	0.0f, 0.0f, 0.0f, 1.0f
     };
 
-    loc = getUniformLoc( program, "zMat" );
-    glUniformMatrix4fv( loc, 1, GL_FALSE, zmat );
+    // compose them:  model = T * X * Y * Z * S
+    GLfloat zs[16], yzs[16], xyzs[16], mmat[16], mvmat[16], nmat[16];
+    mult4( zs, zmat, smat );
+    mult4( yzs, ymat, zs );
+    mult4( xyzs, xmat, yzs );
+    mult4( mmat, tmat, xyzs );
+
+    // then model-view = V * model, and its normal matrix
+    if( !haveView ) {
+        makeCamera( viewMat );
+        haveView = 1;
+    }
+    mult4( mvmat, viewMat, mmat );
+    normalMatrix( nmat, mvmat );
+
+    // with uniform blocks, the matrices go into the current object's
+    // block; otherwise, they're sent as uniforms
+    if( usesUniformBlocks( program ) ) {
+        ObjectBlock *ob = objectBlock();
+        memcpy( ob->mvMat, mvmat, sizeof(mvmat) );
+        memcpy( ob->nMat, nmat, sizeof(nmat) );
+        return;
+    }
+
+    findUniforms( program );
+    sendMat4( mvMatU, mvmat );
+    sendMat4( nMatU, nmat );
 }
 
 ///
@@ -180,61 +355,20 @@ xlate[0], xlate[1], xlate[2] );
 ///
 void setCamera( GLuint program )
 {
-    ///
-    // Begin by calculating the axes of the camera coordinate system
-    ///
-
-    // calculate N
-    Vector tmp = { eye[0] - lookat[0], eye[1] - lookat[1], eye[2] - lookat[2] };
-
-    // normalize it
-    Vector N;
-    norm( N, tmp );
+    GLfloat vmat[16];
 
-    // calculate U
-    Vector U, uvec;
+    makeCamera( vmat );
 
-    // convert 'up' to a Vector
-    uvec[0] = up[0];
-    uvec[1] = up[1];
-    uvec[2] = up[2];
-
-    norm( tmp, uvec );      // normalize 'up'
-    cross( uvec, tmp, N );  // cross 'up' with 'N'
-    norm( U, uvec );       // normalize the result
-
-    // calculate V
-    Vector V;
-
-    cross( tmp, N, U );
-    norm( V, tmp );
-
-    ///
-    // Next, create the camera matrix
-    ///
-
-    // convert eye to vector form
-    Vector evec;
-    memcpy( evec, eye, 3 * sizeof(GLfloat) );
-
-    // compute the dot products
-    float dotue = -1.0f * dot( U, evec );
-    float dotve = -1.0f * dot( V, evec );
-    float dotne = -1.0f * dot( N, evec );
-
-    // create the matrix in column-major order
-    GLfloat vmat[16] = {
-	// column 0
-        U[0], V[0], N[0], 0.0f,
-	// column 1
-        U[1], V[1], N[1], 0.0f,
-	// column 2
-        U[2], V[2], N[2], 0.0f,
-	// column 3
-	dotue, dotve, dotne, 1.0f
-    };
+    // keep it for composing the model-view matrices
+    memcpy( viewMat, vmat, sizeof(vmat) );
+    haveView = 1;
 
     // copy it down to the shader program
-    GLint loc = getUniformLoc( program, "vMat" );
-    glUniformMatrix4fv( loc, 1, GL_FALSE, vmat );
+    if( usesUniformBlocks( program ) ) {
+        memcpy( frameBlock()->vMat, vmat, sizeof(vmat) );
+        return;
+    }
+
+    findUniforms( program );
+    sendMat4( vMatU, vmat );
 }
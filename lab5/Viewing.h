@@ -38,6 +38,9 @@ void setFrustum( GLuint program );
 // of the object.  The order of application is fixed: scaling, Z rotation,
 // Y rotation, X rotation, and then translation.
 //
+// They are composed into the model-view and normal matrices here,
+// using the view matrix from the last setCamera() call.
+//
 // @param program - The ID of an OpenGL (GLSL) shader program to which
 //    parameter values are to be sent
 // @param scale  - scale factors for each axis
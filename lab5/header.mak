@@ -21,7 +21,8 @@ LIBDIRS =
 # common linker options
 # add "-lSOIL" if using that image library
 # add "-lgsl -lgslcblas" if using GSL
-LDLIBS = -lSOIL -lGL -lGLEW -lglfw -lm
+# "-lpthread" is needed for Canvas::computeSmoothNormals()
+LDLIBS = -lSOIL -lGL -lGLEW -lglfw -lpthread -lm
 
 # language-specific linker options
 CLDLIBS =
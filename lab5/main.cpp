@@ -54,6 +54,12 @@ void glfwError( int code, const char *desc )
 ///
 int main( int argc, char *argv[] )
 {
+    // profiling runs need no window (or OpenGL)
+    if( !needWindow( argc, argv ) ) {
+        application( argc, argv );
+        return 0;
+    }
+
     glfwSetErrorCallback( glfwError );
 
     if( !glfwInit() ) {
@@ -3,72 +3,124 @@
 //
 // Fragment shader for SHADER shading.
 //
+// Compiled in the same variants as texture.vert; each does only what
+// it needs to, with no branching on uniform flags.
+//
 // @author  RIT CS Department
 // @author  Jimmy Dugan
 //
 
+#if defined(UNIFORM_BLOCKS)
+#extension GL_ARB_uniform_buffer_object : require
+#endif
+
+// flat shading wins over Gouraud shading
+#if defined(FLAT_SHADING) && defined(GOURAUD_SHADING)
+#undef GOURAUD_SHADING
+#endif
+
+#if defined(GOURAUD_SHADING)
+// Diffuse and specular terms, from the vertex shader
+varying vec2 lightTerms;
+#else
 // Light position
 varying vec3 lPos;
 
-// Vertex position (in clip space)
+// Vertex position (in eye space)
 varying vec3 vPos;
 
+#if !defined(FLAT_SHADING)
 // Vertex normal
 varying vec3 vNorm;
+#endif
+#endif
 
+#if defined(TEXTURED)
 // Texture coordinates
 varying vec2 texCoord;
+#endif
+
+#if defined(UNIFORM_BLOCKS)
+
+// Light color
+layout(std140) uniform Light {
+    vec4 lightPosition;
+    vec4 lightColor;
+    vec4 ambientLight;
+};
+
+// Material properties
+layout(std140) uniform Material {
+    vec4 ambientColor;
+    vec4 diffuseColor;
+    vec4 specularColor;
+    vec3 kCoeff;
+    float specExp;
+    bool usingTextures;
+};
+
+#else
 
 // Light color
 uniform vec4 lightColor;
 uniform vec4 ambientLight;
 
 // Material properties
+#if !defined(TEXTURED)
 uniform vec4 diffuseColor;
 uniform vec4 ambientColor;
 uniform vec4 specularColor;
+#endif
 uniform float specExp;
 uniform vec3 kCoeff;
 
-// Flag controlling texture mapping
-uniform bool usingTextures;
+#endif
 
+#if defined(TEXTURED)
 //incoming
 uniform sampler2D tex_f;
+#if defined(TWO_SIDED)
 uniform sampler2D tex_b;
+#endif
+#endif
 
 void main()
 {
+#if defined(GOURAUD_SHADING)
+    vec2 terms = lightTerms;
+#else
     // calculate lighting vectors
     vec3 L = normalize( lPos - vPos );
+#if defined(FLAT_SHADING)
+    // the polygon's normal, from how the position changes across it
+    vec3 N = normalize( cross( dFdx(vPos), dFdy(vPos) ) );
+#else
     vec3 N = normalize( vNorm );
+#endif
     vec3 R = normalize( reflect(-L, N) );
     vec3 V = normalize( -(vPos) );
 
-    vec4 ambient  = vec4(0.0);  // ambient color component
-    vec4 diffuse  = vec4(0.0);  // diffuse color component
-    vec4 specular = vec4(0.0);  // specular color component
-    float specDot;  // specular dot(R,V) ^ specExp value
-
-    if( usingTextures ){
-        if (gl_FrontFacing) {
-            ambient  = ambientLight * texture2D(tex_f, texCoord);
-            diffuse  = lightColor * texture2D(tex_f, texCoord) * max(dot(N,L),0.0);
-            specDot  = pow( max(dot(R,V),0.0), specExp );
-            specular = lightColor * texture2D(tex_f, texCoord) * specDot;
-        }
-        else {
-            ambient  = ambientLight * texture2D(tex_b, texCoord);
-            diffuse  = lightColor * texture2D(tex_b, texCoord) * max(dot(N,L),0.0);
-            specDot  = pow( max(dot(R,V),0.0), specExp );
-            specular = lightColor * texture2D(tex_b, texCoord) * specDot;
-        }
-    } else {
-        ambient  = ambientLight * ambientColor;
-        diffuse  = lightColor * diffuseColor * max(dot(N,L),0.0);
-        specDot  = pow( max(dot(R,V),0.0), specExp );
-        specular = lightColor * specularColor * specDot;
-    }
+    // diffuse and specular terms
+    vec2 terms = vec2( max( dot(N,L), 0.0 ),
+                       pow( max( dot(R,V), 0.0 ), specExp ) );
+#endif
+
+    // surface colors for the ambient, diffuse, and specular components
+#if defined(TEXTURED)
+#if defined(TWO_SIDED)
+    vec4 texColor = gl_FrontFacing ? texture2D( tex_f, texCoord )
+                                   : texture2D( tex_b, texCoord );
+#else
+    vec4 texColor = texture2D( tex_f, texCoord );
+#endif
+    vec4 ka = texColor, kd = texColor, ks = texColor;
+#else
+    vec4 ka = ambientColor, kd = diffuseColor, ks = specularColor;
+#endif
+
+    vec4 ambient  = ambientLight * ka;
+    vec4 diffuse  = lightColor * kd * terms.x;
+    vec4 specular = lightColor * ks * terms.y;
 
     // calculate the final color
     vec4 color = (kCoeff.x * ambient) +
@@ -3,10 +3,33 @@
 //
 // Vertex shader for SHADER shading.
 //
+// Compiled in several variants, chosen by these definitions (see
+// ShaderVariants.h):
+//
+//    TEXTURED         the surface color comes from textures, not from
+//                     the material colors
+//    TWO_SIDED        back faces have a texture of their own
+//    FLAT_SHADING     lighting is computed once per polygon
+//    GOURAUD_SHADING  lighting is computed at the vertices
+//    UNIFORM_BLOCKS   the parameters come in uniform blocks, laid out
+//                     as the structures in UniformBlocks.h
+//
+// With neither FLAT_SHADING nor GOURAUD_SHADING, lighting is computed
+// for each fragment (Phong shading).
+//
 // @author  RIT CS Department
 // @author  Jimmy Dugan
 //
 
+#if defined(UNIFORM_BLOCKS)
+#extension GL_ARB_uniform_buffer_object : require
+#endif
+
+// flat shading wins over Gouraud shading
+#if defined(FLAT_SHADING) && defined(GOURAUD_SHADING)
+#undef GOURAUD_SHADING
+#endif
+
 //
 // Vertex attributes
 //
@@ -17,106 +40,137 @@ attribute vec4 vPosition;
 // Normal vector at vertex (in model space)
 attribute vec3 vNormal;
 
+#if defined(TEXTURED)
 // Texture coordinate for this vertex
 attribute vec2 vTexCoord;
+#endif
 
 //
 // Uniform data
 //
+// The matrices are composed in the application:  nMat is the inverse
+// transpose of mvMat, in its upper left 3x3.  Light position is given
+// in world space.  Compact vertex data is decoded using packedNormals
+// (normals are octahedral encodings in vNormal.xy) and uvTransform
+// ((u,v) data is vTexCoord * scale + bias).
+//
+
+#if defined(UNIFORM_BLOCKS)
+
+layout(std140) uniform Frame {
+    mat4 pMat;  // projection
+    mat4 vMat;  // view (camera)
+};
+
+layout(std140) uniform Light {
+    vec4 lightPosition;
+    vec4 lightColor;
+    vec4 ambientLight;
+};
+
+layout(std140) uniform Material {
+    vec4 ambientColor;
+    vec4 diffuseColor;
+    vec4 specularColor;
+    vec3 kCoeff;
+    float specExp;
+    bool usingTextures;
+};
+
+layout(std140) uniform Object {
+    mat4 mvMat; // model-view
+    mat4 nMat;  // normal
+    vec4 uvTransform;   // (scale u, scale v, bias u, bias v)
+    bool packedNormals;
+};
+
+#else
 
 // Camera and projection matrices
 uniform mat4 vMat;  // view (camera)
 uniform mat4 pMat;  // projection
 
 // Model transformation matrices
-uniform mat4 tMat;  // translation
-uniform mat4 sMat;  // scaling
-uniform mat4 xMat;  // x rotation
-uniform mat4 yMat;  // y rotation
-uniform mat4 zMat;  // z rotation
+uniform mat4 mvMat; // model-view
+uniform mat4 nMat;  // normal
 
-// Light position is given in world space
+// Light position
 uniform vec4 lightPosition;
 
-// Vectors to "attach" to vertex and get sent to fragment shader
+// Specular exponent, for lighting at the vertices
+uniform float specExp;
+
+// Decoding of compact vertex data
+uniform bool packedNormals;
+uniform vec4 uvTransform;   // (scale u, scale v, bias u, bias v)
+
+#endif
+
+// Values to "attach" to vertex and get sent to fragment shader
 // Vectors and points will be passed in "eye" space
+#if defined(GOURAUD_SHADING)
+varying vec2 lightTerms;    // diffuse and specular
+#else
 varying vec3 lPos;
 varying vec3 vPos;
+#if !defined(FLAT_SHADING)
 varying vec3 vNorm;
+#endif
+#endif
 
+#if defined(TEXTURED)
 //outgoing
 varying vec2 texCoord;
+#endif
 
 //
-// Inversion function for 3x3 matrices by Mikola Lysenko.
-// Origin: https://github.com/glslify/glsl-inverse/blob/master/index.glsl
-//
-// The MIT License (MIT)
+// Recover a normal vector from its octahedral encoding (see
+// octEncode() in Canvas.cpp)
 //
-// Copyright (c) 2014 Mikola Lysenko
-//
-// Permission is hereby granted, free of charge, to any person obtaining a
-// copy of this software and associated documentation files (the "Software"),
-// to deal in the Software without restriction, including without limitation
-// the rights to use, copy, modify, merge, publish, distribute, sublicense,
-// and/or sell copies of the Software, and to permit persons to whom the
-// Software is furnished to do so, subject to the following conditions:
-//
-// The above copyright notice and this permission notice shall be included
-// in all copies or substantial portions of the Software.
-//
-// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
-// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
-// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
-// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
-// OTHER DEALINGS IN THE SOFTWARE.
-//
-
-mat3 inverse(mat3 m) {
-  float a00 = m[0][0], a01 = m[0][1], a02 = m[0][2];
-  float a10 = m[1][0], a11 = m[1][1], a12 = m[1][2];
-  float a20 = m[2][0], a21 = m[2][1], a22 = m[2][2];
-
-  float b01 = a22 * a11 - a12 * a21;
-  float b11 = -a22 * a10 + a12 * a20;
-  float b21 = a21 * a10 - a11 * a20;
-
-  float det = a00 * b01 + a01 * b11 + a02 * b21;
-
-  return mat3(b01, (-a22 * a01 + a02 * a21), (a12 * a01 - a02 * a11),
-              b11, (a22 * a00 - a02 * a20), (-a12 * a00 + a02 * a10),
-              b21, (-a21 * a00 + a01 * a20), (a11 * a00 - a01 * a10)) / det;
+vec3 octDecode( vec2 e ) {
+    vec3 n = vec3( e, 1.0 - abs(e.x) - abs(e.y) );
+    if( n.z < 0.0 ) {
+        vec2 s = vec2( n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0 );
+        n.xy = (1.0 - abs(n.yx)) * s;
+    }
+    return normalize( n );
 }
 
 void main()
 {
-    // create the model and modelview matrices
-    // transformation order: scale, rotate Z, rotate Y, rotate X, translate
-    mat4 modelMat = tMat * xMat * yMat * zMat * sMat;
-    mat4 modelViewMat = vMat * modelMat;
-
     // All vectors need to be converted to "eye" space
     // All vectors should also be normalized
-    vec4 vertexInEye = modelViewMat * vPosition;
+    vec4 vertexInEye = mvMat * vPosition;
     vec4 lightInEye = vMat * lightPosition;
 
-    // "Correct" way to transform normals.  The normal matrix is the
-    // inverse transpose of the upper left 3x3 submatrix of the modelView
-    // matrix (i.e., does not include translations).  THIS IS EXPENSIVE
-    // TO COMPUTE because of the inverse(), and should really be done in
-    // the application, not here.
-    mat3 normMat = inverse( transpose( mat3(modelViewMat) ) );
-    vec4 normalInEye = vec4( normMat * vNormal, 0.0 );
-
+#if !defined(FLAT_SHADING)
+    // Normals are transformed by the normal matrix, which the
+    // application computes once per object
+    vec3 normal = packedNormals ? octDecode( vNormal.xy ) : vNormal;
+    vec4 normalInEye = vec4( mat3(nMat) * normal, 0.0 );
+#endif
+
+#if defined(GOURAUD_SHADING)
+    // light the vertex; the fragment shader applies the colors
+    vec3 L = normalize( lightInEye.xyz - vertexInEye.xyz );
+    vec3 N = normalize( normalInEye.xyz );
+    vec3 R = normalize( reflect( -L, N ) );
+    vec3 V = normalize( -(vertexInEye.xyz) );
+    lightTerms = vec2( max( dot(N,L), 0.0 ),
+                       pow( max( dot(R,V), 0.0 ), specExp ) );
+#else
     // pass our vertex data to the fragment shader
     lPos = lightInEye.xyz;
     vPos = vertexInEye.xyz;
+#if !defined(FLAT_SHADING)
     vNorm = normalInEye.xyz;
+#endif
+#endif
 
-    texCoord = vTexCoord;
+#if defined(TEXTURED)
+    texCoord = vTexCoord * uvTransform.xy + uvTransform.zw;
+#endif
 
     // send the vertex position into clip space
-    gl_Position =  pMat * modelViewMat * vPosition;
+    gl_Position =  pMat * vertexInEye;
 }
@@ -15,9 +15,11 @@ using namespace std;
 #include <stdbool.h>
 #endif
 #include <iostream>
+#include <algorithm>
 #include "Pipeline.h"
 #include "Rasterizer.h"
 #include "Clipper.h"
+#include "PipelineStats.h"
 #include <math.h>
 
 ///
@@ -65,9 +67,280 @@ int Pipeline::addPoly(int n,
     vector < Vertex > tempVector;
     tempVector.insert(tempVector.end(), & p[0], & p[n]);
     polyRepository.push_back(tempVector);
+    curveRepository.push_back(vector < CurveSegment > ());
+    detailRepository.push_back(buildDetail(n, p));
     return polyID++;
 }
 
+///
+/// addCurvePoly - Add a polygon whose outline is made of line,
+///           quadratic and cubic Bezier segments.  The outline is
+///           flattened when it is drawn, with a vertex density
+///           chosen from the current transformation's scale.
+///
+/// @param n - Number of segments in the outline
+/// @param segs - Array of segments defining the outline
+///
+/// @return a unique integer identifier for the polygon
+///
+int Pipeline::addCurvePoly(int n, const CurveSegment segs[]) {
+    curveRepository.push_back(vector < CurveSegment > (& segs[0], & segs[n]));
+    // keep a unit-scale flattening in the repository, so the polygon
+    // has vertices wherever a plain polygon is expected
+    polyRepository.push_back(flattenCurvePoly(polyID, 1));
+
+    // a Bezier segment lies inside the hull of its control points,
+    // so their bounding box also bounds the curve
+    PolyDetail detail;
+    detail.ll = detail.ur = n > 0 ? segs[0].end : Vertex {0, 0};
+    for (int segIter = 0; segIter < n; segIter++) {
+        const CurveSegment &seg = segs[segIter];
+        vector < Vertex > points(1, seg.end);
+        if (seg.kind != SEG_LINE) {
+            points.push_back(seg.c1);
+        }
+        if (seg.kind == SEG_CUBIC) {
+            points.push_back(seg.c2);
+        }
+        for (const Vertex &point : points) {
+            detail.ll.x = min(detail.ll.x, point.x);
+            detail.ll.y = min(detail.ll.y, point.y);
+            detail.ur.x = max(detail.ur.x, point.x);
+            detail.ur.y = max(detail.ur.y, point.y);
+        }
+    }
+    detailRepository.push_back(detail);
+    return polyID++;
+}
+
+///
+/// flattenCurvePoly - Get the vertices of a curved polygon, flattened
+///           finely enough for a transformation with the given scale.
+///           Results are cached per power-of-two scale bucket.
+///
+/// @param polyID - the ID of a polygon added with addCurvePoly()
+/// @param scale - screen pixels per model unit
+///
+/// @return the flattened vertices
+///
+const vector < Vertex > &Pipeline::flattenCurvePoly(int polyID, float scale) {
+    // round the scale up to a power of two so nearby zoom levels share
+    // one flattening, which is then at worst finer than needed
+    int bucket = int(ceil(log2(max(scale, 1e-6f))));
+    bucket = min(max(bucket, -16), 16);
+
+    auto cached = flattenCache.find(make_pair(polyID, bucket));
+    if (cached != flattenCache.end()) {
+        return cached->second;
+    }
+
+    // largest allowed deviation from the curve, in model units
+    float tolerance = curveTolerance / ldexp(1.0f, bucket);
+
+    const vector < CurveSegment > &segs = curveRepository.at(polyID);
+    vector < Vertex > &flat = flattenCache[make_pair(polyID, bucket)];
+    Vertex start = segs.empty() ? Vertex {0, 0} : segs.back().end;
+
+    for (const CurveSegment &seg : segs) {
+        Vertex p0 = start, p1 = seg.c1, p2 = seg.c2, p3 = seg.end;
+
+        // Wang's formula: the number of line segments needed to stay within
+        // the tolerance, from the largest second difference of the control points
+        int steps = 1;
+        if (seg.kind == SEG_QUADRATIC) {
+            float dd = hypot(p0.x - 2 * p1.x + p3.x, p0.y - 2 * p1.y + p3.y);
+            steps = int(ceil(sqrt(dd / (4 * tolerance))));
+        } else if (seg.kind == SEG_CUBIC) {
+            float dd = max(hypot(p0.x - 2 * p1.x + p2.x, p0.y - 2 * p1.y + p2.y),
+                           hypot(p1.x - 2 * p2.x + p3.x, p1.y - 2 * p2.y + p3.y));
+            steps = int(ceil(sqrt(3 * dd / (4 * tolerance))));
+        }
+        steps = min(max(steps, 1), 1024);
+
+        // emit the points after the start point; the start point was
+        // emitted as the end of the previous segment
+        for (int stepIter = 1; stepIter <= steps; stepIter++) {
+            float t = float(stepIter) / steps;
+            float u = 1 - t;
+            Vertex v;
+            if (seg.kind == SEG_QUADRATIC) {
+                v = Vertex {
+                    u * u * p0.x + 2 * u * t * p1.x + t * t * p3.x,
+                    u * u * p0.y + 2 * u * t * p1.y + t * t * p3.y
+                };
+            } else if (seg.kind == SEG_CUBIC) {
+                v = Vertex {
+                    u * u * u * p0.x + 3 * u * u * t * p1.x + 3 * u * t * t * p2.x + t * t * t * p3.x,
+                    u * u * u * p0.y + 3 * u * u * t * p1.y + 3 * u * t * t * p2.y + t * t * t * p3.y
+                };
+            } else {
+                v = p3;
+            }
+            flat.push_back(v);
+        }
+        start = seg.end;
+    }
+    return flat;
+}
+
+///
+/// compositeScale - Get an upper bound on the screen pixels per model
+///           unit of a model transformation, after normalization
+///           and viewport transformation.
+///
+/// @param model - the model transformation
+///
+/// @return the scale factor
+///
+float Pipeline::compositeScale(const Affine2D &model) {
+    Affine2D screen = composeAffine(toAffine(viewPortTransformation),
+                                    composeAffine(toAffine(normTransformation), model));
+    // the Frobenius norm bounds the largest stretch in any direction
+    return sqrt(screen.a * screen.a + screen.b * screen.b + screen.c * screen.c + screen.d * screen.d);
+}
+
+///
+/// buildDetail - Compute the bounding box and the chain of simplified
+///           versions (Douglas-Peucker) of a polygon.
+///
+/// @param n - Number of vertices in polygon
+/// @param p - Array containing the vertices of the polygon
+///
+/// @return the level-of-detail data for the polygon
+///
+Pipeline::PolyDetail Pipeline::buildDetail(int n, const Vertex p[]) {
+    PolyDetail detail;
+    detail.ll = detail.ur = n > 0 ? Vertex {p[0].x, p[0].y} : Vertex {0, 0};
+    for (int vertexIter = 1; vertexIter < n; vertexIter++) {
+        detail.ll.x = min(detail.ll.x, p[vertexIter].x);
+        detail.ll.y = min(detail.ll.y, p[vertexIter].y);
+        detail.ur.x = max(detail.ur.x, p[vertexIter].x);
+        detail.ur.y = max(detail.ur.y, p[vertexIter].y);
+    }
+
+    if (n < lodMinVertices) {
+        return detail;
+    }
+
+    //simplify at tolerances from 1/2048 to 1/8 of the bounding box
+    //diagonal, keeping only levels that drop at least a quarter of the
+    //vertices of the next finer one
+    float diagonal = hypot(detail.ur.x - detail.ll.x, detail.ur.y - detail.ll.y);
+    size_t finerCount = n;
+    for (float fraction = 1.0f / 2048; fraction <= 1.0f / 8; fraction *= 4) {
+        vector < Vertex > level = simplifyPolygon(n, p, diagonal * fraction);
+        if (level.size() < 3) {
+            break;
+        }
+        if (level.size() * 4 > finerCount * 3) {
+            continue;
+        }
+        finerCount = level.size();
+        //coarsest level first
+        detail.tolerances.insert(detail.tolerances.begin(), diagonal * fraction);
+        detail.levels.insert(detail.levels.begin(), level);
+    }
+    return detail;
+}
+
+///
+/// simplifyPolygon - Simplify a closed polygon with the Douglas-Peucker
+///           algorithm.
+///
+/// @param n - Number of vertices in polygon
+/// @param p - Array containing the vertices of the polygon
+/// @param tolerance - largest allowed distance from the original
+///
+/// @return the vertices that were kept
+///
+vector < Vertex > Pipeline::simplifyPolygon(int n, const Vertex p[], float tolerance) {
+    if (n < 4) {
+        return vector < Vertex > (& p[0], & p[n]);
+    }
+
+    //split the ring into two chains at the vertex farthest from the first
+    int split = 0;
+    float farthest = -1;
+    for (int vertexIter = 1; vertexIter < n; vertexIter++) {
+        float dist = hypot(p[vertexIter].x - p[0].x, p[vertexIter].y - p[0].y);
+        if (dist > farthest) {
+            farthest = dist;
+            split = vertexIter;
+        }
+    }
+
+    vector < bool > keep(n, false);
+    keep[0] = keep[split] = true;
+
+    //chains still to be simplified, as (first, last) indices; index n is vertex 0
+    vector < pair < int, int > > chains;
+    chains.push_back(make_pair(0, split));
+    chains.push_back(make_pair(split, n));
+    while (!chains.empty()) {
+        int first = chains.back().first;
+        int last = chains.back().second;
+        chains.pop_back();
+
+        //find the vertex farthest from the segment joining the chain's ends
+        Vertex a = p[first], b = p[last % n];
+        float dx = b.x - a.x, dy = b.y - a.y;
+        float lengthSq = dx * dx + dy * dy;
+        float maxDist = -1;
+        int maxIter = first;
+        for (int vertexIter = first + 1; vertexIter < last; vertexIter++) {
+            float t = lengthSq > 0 ? ((p[vertexIter].x - a.x) * dx + (p[vertexIter].y - a.y) * dy) / lengthSq : 0;
+            t = min(max(t, 0.0f), 1.0f);
+            float dist = hypot(p[vertexIter].x - (a.x + t * dx), p[vertexIter].y - (a.y + t * dy));
+            if (dist > maxDist) {
+                maxDist = dist;
+                maxIter = vertexIter;
+            }
+        }
+
+        //keep it and split the chain there if it is too far away
+        if (maxDist > tolerance) {
+            keep[maxIter] = true;
+            chains.push_back(make_pair(first, maxIter));
+            chains.push_back(make_pair(maxIter, last));
+        }
+    }
+
+    vector < Vertex > kept;
+    for (int vertexIter = 0; vertexIter < n; vertexIter++) {
+        if (keep[vertexIter]) {
+            kept.push_back(p[vertexIter]);
+        }
+    }
+    return kept;
+}
+
+///
+/// polyVertices - Get the vertices to draw for a polygon at the given
+///           scale: a curve flattening, a simplified level, or the
+///           original vertices.
+///
+/// @param polyID - the ID of the polygon
+/// @param scale - screen pixels per model unit
+///
+/// @return the vertices to draw
+///
+const vector < Vertex > &Pipeline::polyVertices(int polyID, float scale) {
+    //curved polygons are flattened for the scale
+    if (!curveRepository.at(polyID).empty()) {
+        return flattenCurvePoly(polyID, scale);
+    }
+
+    //levels run from coarsest to finest
+    const PolyDetail &detail = detailRepository[polyID];
+    float tolerance = lodTolerance / max(scale, 1e-6f);
+    for (size_t levelIter = 0; levelIter < detail.levels.size(); levelIter++) {
+        if (detail.tolerances[levelIter] <= tolerance) {
+            return detail.levels[levelIter];
+        }
+    }
+    return polyRepository[polyID];
+}
+
 ///
 /// drawPoly - Draw the polygon with the given id.  The polygon should
 ///            be drawn after applying the current transformation to
@@ -76,7 +349,52 @@ int Pipeline::addPoly(int n,
 /// @param polyID - the ID of the polygon to be drawn.
 ///
 void Pipeline::drawPoly(int polyID) {
-    vector < Vertex > polyPoints = polyRepository.at(polyID);
+    if (polyRepository.at(polyID).empty()) {
+        return;
+    }
+
+    STATS_BEGIN(STAGE_TRANSFORM);
+
+    //find the bounding box of the polygon after normalization
+    const PolyDetail &detail = detailRepository[polyID];
+    Affine2D model = toAffine(modelTransformation);
+    Affine2D normalization = composeAffine(toAffine(normTransformation), model);
+    Vertex corners[4] = {
+        {detail.ll.x, detail.ll.y}, {detail.ur.x, detail.ll.y},
+        {detail.ur.x, detail.ur.y}, {detail.ll.x, detail.ur.y}
+    };
+    transformVertices(4, corners, corners, normalization);
+    float minX = corners[0].x, maxX = corners[0].x;
+    float minY = corners[0].y, maxY = corners[0].y;
+    for (int cornerIter = 1; cornerIter < 4; cornerIter++) {
+        minX = min(minX, corners[cornerIter].x);
+        maxX = max(maxX, corners[cornerIter].x);
+        minY = min(minY, corners[cornerIter].y);
+        maxY = max(maxY, corners[cornerIter].y);
+    }
+
+    //entirely outside the clip window, nothing to draw
+    if (maxX < -1 || minX > 1 || maxY < -1 || minY > 1) {
+        STATS_END(STAGE_TRANSFORM);
+        STATS_COUNT(polygonsCulled, 1);
+        return;
+    }
+
+    //smaller than a pixel on screen, draw a single pixel at its center
+    Affine2D viewPort = toAffine(viewPortTransformation);
+    if ((maxX - minX) * fabs(viewPort.a) < 1 && (maxY - minY) * fabs(viewPort.d) < 1) {
+        Vertex center = {(minX + maxX) / 2, (minY + maxY) / 2};
+        if (center.x >= -1 && center.x <= 1 && center.y >= -1 && center.y <= 1) {
+            transformVertices(1, &center, &center, viewPort);
+            addPixel(Vertex {floor(center.x), floor(center.y)});
+        }
+        STATS_END(STAGE_TRANSFORM);
+        STATS_COUNT(polygonsCollapsed, 1);
+        return;
+    }
+
+    //pick the coarsest version of the polygon that is accurate enough
+    const vector < Vertex > &polyPoints = polyVertices(polyID, compositeScale(model));
     int numberOfPoints = int(polyPoints.size());
     Vertex pointsArr[numberOfPoints];
     copy(polyPoints.begin(), polyPoints.end(), pointsArr);
@@ -93,20 +411,175 @@ void Pipeline::drawPoly(int polyID) {
     applyTransformation(numberOfPoints, postModelTransVertices, normTransformedMatrices, normTransformation);
     Vertex postNormalizationVertices[numberOfPoints];
     convertMatrixToVertexArray(numberOfPoints, normTransformedMatrices, postNormalizationVertices);
+    STATS_END(STAGE_TRANSFORM);
 
     //apply clipping
+    STATS_BEGIN(STAGE_CLIP);
     Vertex postClippedVertices[numberOfPoints * 2];
     int numberOfPointsPostClip = clipPolygon(numberOfPoints, postNormalizationVertices, postClippedVertices,
                                  Vertex {-1, -1}, Vertex {1, 1});
+    STATS_END(STAGE_CLIP);
+    STATS_COUNT(clipVerticesIn, numberOfPoints);
+    STATS_COUNT(clipVerticesOut, numberOfPointsPostClip);
+    if (numberOfPointsPostClip == 0) {
+        STATS_COUNT(polygonsCulled, 1);
+        return;
+    }
 
     //apply viewport transformation
+    STATS_BEGIN(STAGE_VIEWPORT);
     Matrix viewPortTransformedMatrices[numberOfPointsPostClip];
     applyTransformation(numberOfPointsPostClip, postClippedVertices, viewPortTransformedMatrices, viewPortTransformation);
     Vertex finalVertices[numberOfPointsPostClip];
     convertMatrixToVertexArray(numberOfPointsPostClip, viewPortTransformedMatrices, finalVertices);
+    STATS_END(STAGE_VIEWPORT);
 
+    STATS_BEGIN(STAGE_RASTER);
     Rasterizer rasterizer = Rasterizer(numberOfPointsPostClip, * this);
     rasterizer.drawPolygon(numberOfPointsPostClip, finalVertices);
+    STATS_END(STAGE_RASTER);
+    STATS_COUNT(polygonsDrawn, 1);
+}
+
+///
+/// drawPolyInstanced - Draw 'count' copies of the polygon with the
+///            given id.  Instance i is drawn with transforms[i] in
+///            place of the current model transformation.  The stored
+///            vertices are read once, and every instance shares the
+///            same scratch buffers and rasterizer.
+///
+/// @param polyID - the ID of the polygon to be drawn.
+/// @param count - number of instances to draw
+/// @param transforms - array of 'count' model transformations
+///
+void Pipeline::drawPolyInstanced(int polyID, int count, const Affine2D *transforms) {
+    if (count < 1) {
+        return;
+    }
+
+    //pick one version of the polygon, accurate enough for the largest instance
+    float maxScale = 0;
+    for (int instanceIter = 0; instanceIter < count; instanceIter++) {
+        maxScale = max(maxScale, compositeScale(transforms[instanceIter]));
+    }
+    const vector < Vertex > &basePoints = polyVertices(polyID, maxScale);
+    int numberOfPoints = int(basePoints.size());
+    if (numberOfPoints == 0) {
+        return;
+    }
+
+    //the normalization and viewport transformations are the same for every instance
+    Affine2D normAffine = toAffine(normTransformation);
+    Affine2D viewPortAffine = toAffine(viewPortTransformation);
+
+    //scratch buffers shared by all instances; clipping against the four
+    //window edges can add at most one vertex per edge
+    vector < Vertex > normalizedVertices(numberOfPoints);
+    vector < Vertex > clippedVertices(numberOfPoints * 2 + 4);
+    Rasterizer rasterizer = Rasterizer(numberOfPoints, * this);
+
+    for (int instanceIter = 0; instanceIter < count; instanceIter++) {
+        //apply model and normalization transformations in one pass
+        STATS_BEGIN(STAGE_TRANSFORM);
+        Affine2D composite = composeAffine(normAffine, transforms[instanceIter]);
+        transformVertices(numberOfPoints, basePoints.data(), normalizedVertices.data(), composite);
+
+        //classify the instance against the clip window
+        bool allLeft = true, allRight = true, allBelow = true, allAbove = true;
+        bool allInside = true;
+        for (int vertexIter = 0; vertexIter < numberOfPoints; vertexIter++) {
+            float x = normalizedVertices[vertexIter].x;
+            float y = normalizedVertices[vertexIter].y;
+            allLeft = allLeft && x < -1;
+            allRight = allRight && x > 1;
+            allBelow = allBelow && y < -1;
+            allAbove = allAbove && y > 1;
+            allInside = allInside && x >= -1 && x <= 1 && y >= -1 && y <= 1;
+        }
+        STATS_END(STAGE_TRANSFORM);
+
+        //entirely outside one edge of the window, nothing to draw
+        if (allLeft || allRight || allBelow || allAbove) {
+            STATS_COUNT(polygonsCulled, 1);
+            continue;
+        }
+
+        //apply clipping, unless the instance is entirely inside the window
+        const Vertex *clipped = normalizedVertices.data();
+        int numberOfPointsPostClip = numberOfPoints;
+        if (!allInside) {
+            STATS_BEGIN(STAGE_CLIP);
+            numberOfPointsPostClip = clipPolygon(numberOfPoints, normalizedVertices.data(),
+                                                 clippedVertices.data(), Vertex {-1, -1}, Vertex {1, 1});
+            clipped = clippedVertices.data();
+            STATS_END(STAGE_CLIP);
+            STATS_COUNT(clipVerticesIn, numberOfPoints);
+            STATS_COUNT(clipVerticesOut, numberOfPointsPostClip);
+        }
+        if (numberOfPointsPostClip == 0) {
+            STATS_COUNT(polygonsCulled, 1);
+            continue;
+        }
+
+        //apply viewport transformation
+        STATS_BEGIN(STAGE_VIEWPORT);
+        Vertex finalVertices[numberOfPointsPostClip];
+        transformVertices(numberOfPointsPostClip, clipped, finalVertices, viewPortAffine);
+        STATS_END(STAGE_VIEWPORT);
+
+        STATS_BEGIN(STAGE_RASTER);
+        rasterizer.drawPolygon(numberOfPointsPostClip, finalVertices);
+        STATS_END(STAGE_RASTER);
+        STATS_COUNT(polygonsDrawn, 1);
+    }
+}
+
+///
+/// toAffine - convert a 3x3 transformation matrix to an Affine2D
+/// @param m - the matrix to convert
+///
+/// @return the equivalent affine transformation
+///
+Affine2D Pipeline::toAffine(Matrix m) {
+    Affine2D t = {
+        m[0][0], m[0][1], m[0][2],
+        m[1][0], m[1][1], m[1][2]
+    };
+    return t;
+}
+
+///
+/// composeAffine - compute the product l * r of two transformations
+/// @param l - the transformation applied second
+/// @param r - the transformation applied first
+///
+/// @return the combined transformation
+///
+Affine2D Pipeline::composeAffine(const Affine2D &l, const Affine2D &r) {
+    Affine2D t = {
+        l.a * r.a + l.b * r.c, l.a * r.b + l.b * r.d, l.a * r.tx + l.b * r.ty + l.tx,
+        l.c * r.a + l.d * r.c, l.c * r.b + l.d * r.d, l.c * r.tx + l.d * r.ty + l.ty
+    };
+    return t;
+}
+
+///
+/// transformVertices - Apply an affine transformation to an array
+///            of vertices
+/// @param n - number of vertices in the array
+/// @param inV - incoming vertices array
+/// @param outV - outgoing vertices array (may be the same as inV)
+/// @param t - the transformation to apply
+///
+void Pipeline::transformVertices(int n, const Vertex inV[], Vertex outV[], const Affine2D &t) {
+    for (int vertexIter = 0; vertexIter < n; vertexIter++) {
+        float x = inV[vertexIter].x;
+        float y = inV[vertexIter].y;
+        outV[vertexIter] = Vertex {
+            t.a * x + t.b * y + t.tx,
+            t.c * x + t.d * y + t.ty
+        };
+    }
 }
 
 ///
@@ -161,6 +634,138 @@ void Pipeline::clearTransform(void) {
     modelTransformation = clearM;
 }
 
+///
+/// pushTransform - Save a copy of the current transformation; it is
+///            restored by the matching popTransform().
+///
+void Pipeline::pushTransform(void) {
+    transformStack.push_back(modelTransformation);
+}
+
+///
+/// popTransform - Replace the current transformation with the one
+///            most recently saved by pushTransform().
+///
+void Pipeline::popTransform(void) {
+    if (transformStack.empty()) {
+        cerr << "popTransform: transform stack is empty" << endl;
+        return;
+    }
+    modelTransformation = transformStack.back();
+    transformStack.pop_back();
+}
+
+///
+/// addNode - Add a node to the transformation hierarchy.  The new
+///            node's local transformation is the identity.
+///
+/// @param parent - id of the parent node, or -1 for a root node
+///
+/// @return a unique integer identifier for the node
+///
+int Pipeline::addNode(int parent) {
+    Affine2D identity = {
+        1, 0, 0,
+        0, 1, 0
+    };
+    TransformNode node;
+    node.parent = parent;
+    node.local = identity;
+    node.world = identity;
+    node.dirty = true;
+
+    int nodeID = int(transformNodes.size());
+    if (parent >= 0) {
+        transformNodes.at(parent).children.push_back(nodeID);
+    }
+    transformNodes.push_back(node);
+    return nodeID;
+}
+
+///
+/// setNodeTransform - Replace the local transformation of a node.
+///            The cached world transformations of the node and all
+///            of its descendants are invalidated.
+///
+/// @param node - the ID of the node
+/// @param local - the node's new transformation relative to its parent
+///
+void Pipeline::setNodeTransform(int node, const Affine2D &local) {
+    transformNodes.at(node).local = local;
+
+    // mark the subtree dirty; a subtree that is already dirty
+    // has dirty descendants, so there is no need to walk it
+    vector < int > pending(1, node);
+    while (!pending.empty()) {
+        TransformNode &curr = transformNodes[pending.back()];
+        pending.pop_back();
+        if (curr.dirty) {
+            continue;
+        }
+        curr.dirty = true;
+        pending.insert(pending.end(), curr.children.begin(), curr.children.end());
+    }
+}
+
+///
+/// getNodeWorld - Get the world transformation of a node, recomputing
+///            it (and any stale ancestors) only if it is out of date.
+///
+/// @param node - the ID of the node
+///
+/// @return the node's world transformation
+///
+const Affine2D &Pipeline::getNodeWorld(int node) {
+    if (!transformNodes.at(node).dirty) {
+        return transformNodes[node].world;
+    }
+
+    // collect the dirty ancestors; a clean node's ancestors are all clean
+    vector < int > stale;
+    for (int curr = node; curr >= 0 && transformNodes[curr].dirty; curr = transformNodes[curr].parent) {
+        stale.push_back(curr);
+    }
+
+    // recompute from the top down
+    for (auto staleIter = stale.rbegin(); staleIter != stale.rend(); staleIter++) {
+        TransformNode &curr = transformNodes[*staleIter];
+        if (curr.parent >= 0) {
+            curr.world = composeAffine(transformNodes[curr.parent].world, curr.local);
+        } else {
+            curr.world = curr.local;
+        }
+        curr.dirty = false;
+    }
+    return transformNodes[node].world;
+}
+
+///
+/// loadNodeTransform - Set the current transformation to the world
+///            transformation of a node.
+///
+/// @param node - the ID of the node
+///
+void Pipeline::loadNodeTransform(int node) {
+    const Affine2D &world = getNodeWorld(node);
+    float worldMatrix[] {
+        world.a, world.b, world.tx,
+        world.c, world.d, world.ty,
+        0, 0, 1
+    };
+    modelTransformation = Matrix(3, 3, worldMatrix);
+}
+
+///
+/// drawPolyNode - Draw the polygon with the given id using the world
+///            transformation of a node in place of the current one.
+///
+/// @param polyID - the ID of the polygon to be drawn.
+/// @param node - the ID of the node
+///
+void Pipeline::drawPolyNode(int polyID, int node) {
+    drawPolyInstanced(polyID, 1, &getNodeWorld(node));
+}
+
 ///
 /// translate - Add a translation to the current transformation by
 ///             premultiplying the appropriate translation matrix to
@@ -15,12 +15,45 @@
 #include "Canvas.h"
 #include "Types.h"
 #include "cmatrix"
+#include <map>
 
 using namespace std;
 
 // used for a Matrix
 typedef techsoft::matrix<float> Matrix;
 
+///
+/// A 2D affine transformation, stored as the top two rows of the
+/// equivalent 3x3 homogeneous matrix:
+///
+///     | a  b  tx |
+///     | c  d  ty |
+///     | 0  0  1  |
+///
+typedef struct st_affine2d {
+    float a, b, tx;
+    float c, d, ty;
+} Affine2D;
+
+///
+/// Kinds of segments in a curved polygon outline
+///
+typedef enum segKind {
+    SEG_LINE, SEG_QUADRATIC, SEG_CUBIC
+} SegmentKind;
+
+///
+/// One segment of a curved polygon outline.  A segment starts at the
+/// end point of the previous segment; the first segment starts at the
+/// end point of the last one, which closes the outline.
+///
+typedef struct st_curveseg {
+    SegmentKind kind;
+    Vertex c1;      // first control point (quadratic and cubic)
+    Vertex c2;      // second control point (cubic only)
+    Vertex end;     // end point of the segment
+} CurveSegment;
+
 ///
 /// Simple wrapper class for midterm assignment
 ///
@@ -40,10 +73,53 @@ public:
     vector<vector<Vertex>> polyRepository;
     // ID associated to each polygon in the polyRepository
     int polyID = 0;
+    // Outline segments of each curved polygon, indexed by polygon ID
+    // (empty for polygons added with addPoly())
+    vector<vector<CurveSegment>> curveRepository;
+    // Flattened curved polygons, keyed by polygon ID and scale bucket
+    map<pair<int, int>, vector<Vertex>> flattenCache;
+    // Maximum distance (in pixels) between a curve and its flattening
+    float curveTolerance = 0.25f;
+
+    ///
+    /// Level-of-detail data for a polygon: its bounding box, and
+    /// simplified versions of it ordered from coarsest to finest.
+    /// Level k is within tolerances[k] model units of the original.
+    ///
+    struct PolyDetail {
+        Vertex ll;              // lower-left corner of the bounding box
+        Vertex ur;              // upper-right corner of the bounding box
+        vector<float> tolerances;
+        vector<vector<Vertex>> levels;
+    };
+    // Level-of-detail data, indexed by polygon ID
+    vector<PolyDetail> detailRepository;
+    // Polygons with fewer vertices than this are never simplified
+    int lodMinVertices = 32;
+    // Maximum distance (in pixels) between a polygon and its simplification
+    float lodTolerance = 0.5f;
     // variables to store current transformation
     Matrix modelTransformation;
     Matrix normTransformation;
     Matrix viewPortTransformation;
+    // saved model transformations for pushTransform()/popTransform()
+    vector<Matrix> transformStack;
+
+    ///
+    /// A node in a transformation hierarchy.  A node's world transformation
+    /// is its parent's world transformation times its own local one; it is
+    /// cached, and recomputed only after the node or an ancestor changes.
+    /// A dirty node's descendants are always dirty as well.
+    ///
+    struct TransformNode {
+        int parent;             // -1 for a root node
+        vector<int> children;
+        Affine2D local;
+        Affine2D world;
+        bool dirty;
+    };
+    // all nodes, indexed by the id returned from addNode()
+    vector<TransformNode> transformNodes;
     
     ///
     /// Constructor
@@ -65,6 +141,77 @@ public:
     ///
     int addPoly( int n, const Vertex p[] );
 
+    ///
+    /// addCurvePoly - Add a polygon whose outline is made of line,
+    ///           quadratic and cubic Bezier segments.  The outline is
+    ///           flattened when it is drawn, with a vertex density
+    ///           chosen from the current transformation's scale.
+    ///
+    /// @param n - Number of segments in the outline
+    /// @param segs - Array of segments defining the outline
+    ///
+    /// @return a unique integer identifier for the polygon
+    ///
+    int addCurvePoly( int n, const CurveSegment segs[] );
+
+    ///
+    /// flattenCurvePoly - Get the vertices of a curved polygon, flattened
+    ///           finely enough for a transformation with the given scale.
+    ///           Results are cached per power-of-two scale bucket.
+    ///
+    /// @param polyID - the ID of a polygon added with addCurvePoly()
+    /// @param scale - screen pixels per model unit
+    ///
+    /// @return the flattened vertices
+    ///
+    const vector<Vertex> &flattenCurvePoly( int polyID, float scale );
+
+    ///
+    /// compositeScale - Get an upper bound on the screen pixels per model
+    ///           unit of a model transformation, after normalization
+    ///           and viewport transformation.
+    ///
+    /// @param model - the model transformation
+    ///
+    /// @return the scale factor
+    ///
+    float compositeScale( const Affine2D &model );
+
+    ///
+    /// buildDetail - Compute the bounding box and the chain of simplified
+    ///           versions (Douglas-Peucker) of a polygon.
+    ///
+    /// @param n - Number of vertices in polygon
+    /// @param p - Array containing the vertices of the polygon
+    ///
+    /// @return the level-of-detail data for the polygon
+    ///
+    PolyDetail buildDetail( int n, const Vertex p[] );
+
+    ///
+    /// simplifyPolygon - Simplify a closed polygon with the Douglas-Peucker
+    ///           algorithm.
+    ///
+    /// @param n - Number of vertices in polygon
+    /// @param p - Array containing the vertices of the polygon
+    /// @param tolerance - largest allowed distance from the original
+    ///
+    /// @return the vertices that were kept
+    ///
+    vector<Vertex> simplifyPolygon( int n, const Vertex p[], float tolerance );
+
+    ///
+    /// polyVertices - Get the vertices to draw for a polygon at the given
+    ///           scale: a curve flattening, a simplified level, or the
+    ///           original vertices.
+    ///
+    /// @param polyID - the ID of the polygon
+    /// @param scale - screen pixels per model unit
+    ///
+    /// @return the vertices to draw
+    ///
+    const vector<Vertex> &polyVertices( int polyID, float scale );
+
     ///
     /// drawPoly - Draw the polygon with the given id.  The polygon should
     ///            be drawn after applying the current transformation to
@@ -73,6 +220,47 @@ public:
     /// @param polyID - the ID of the polygon to be drawn.
     ///
     void drawPoly( int polyID );
+
+    ///
+    /// drawPolyInstanced - Draw 'count' copies of the polygon with the
+    ///            given id.  Instance i is drawn with transforms[i] in
+    ///            place of the current model transformation.  The stored
+    ///            vertices are read once, and every instance shares the
+    ///            same scratch buffers and rasterizer.
+    ///
+    /// @param polyID - the ID of the polygon to be drawn.
+    /// @param count - number of instances to draw
+    /// @param transforms - array of 'count' model transformations
+    ///
+    void drawPolyInstanced( int polyID, int count, const Affine2D *transforms );
+
+    ///
+    /// toAffine - convert a 3x3 transformation matrix to an Affine2D
+    /// @param m - the matrix to convert
+    ///
+    /// @return the equivalent affine transformation
+    ///
+    Affine2D toAffine( Matrix m );
+
+    ///
+    /// composeAffine - compute the product l * r of two transformations
+    /// @param l - the transformation applied second
+    /// @param r - the transformation applied first
+    ///
+    /// @return the combined transformation
+    ///
+    Affine2D composeAffine( const Affine2D &l, const Affine2D &r );
+
+    ///
+    /// transformVertices - Apply an affine transformation to an array
+    ///            of vertices
+    /// @param n - number of vertices in the array
+    /// @param inV - incoming vertices array
+    /// @param outV - outgoing vertices array (may be the same as inV)
+    /// @param t - the transformation to apply
+    ///
+    void transformVertices( int n, const Vertex inV[], Vertex outV[],
+                            const Affine2D &t );
     
     ///
     /// convertMatrixToVertexArray - convert the matrices to an array of vertices
@@ -99,6 +287,65 @@ public:
     ///
     void clearTransform( void );
 
+    ///
+    /// pushTransform - Save a copy of the current transformation; it is
+    ///            restored by the matching popTransform().
+    ///
+    void pushTransform( void );
+
+    ///
+    /// popTransform - Replace the current transformation with the one
+    ///            most recently saved by pushTransform().
+    ///
+    void popTransform( void );
+
+    ///
+    /// addNode - Add a node to the transformation hierarchy.  The new
+    ///            node's local transformation is the identity.
+    ///
+    /// @param parent - id of the parent node, or -1 for a root node
+    ///
+    /// @return a unique integer identifier for the node
+    ///
+    int addNode( int parent );
+
+    ///
+    /// setNodeTransform - Replace the local transformation of a node.
+    ///            The cached world transformations of the node and all
+    ///            of its descendants are invalidated.
+    ///
+    /// @param node - the ID of the node
+    /// @param local - the node's new transformation relative to its parent
+    ///
+    void setNodeTransform( int node, const Affine2D &local );
+
+    ///
+    /// getNodeWorld - Get the world transformation of a node, recomputing
+    ///            it (and any stale ancestors) only if it is out of date.
+    ///
+    /// @param node - the ID of the node
+    ///
+    /// @return the node's world transformation
+    ///
+    const Affine2D &getNodeWorld( int node );
+
+    ///
+    /// loadNodeTransform - Set the current transformation to the world
+    ///            transformation of a node.
+    ///
+    /// @param node - the ID of the node
+    ///
+    void loadNodeTransform( int node );
+
+    ///
+    /// drawPolyNode - Draw the polygon with the given id using the world
+    ///            transformation of a node in place of the current one.
+    ///
+    /// @param polyID - the ID of the polygon to be drawn.
+    /// @param node - the ID of the node
+    ///
+    void drawPolyNode( int polyID, int node );
+
     ///
     /// translate - Add a translation to the current transformation by
     ///             premultiplying the appropriate translation matrix to
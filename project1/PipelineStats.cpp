@@ -0,0 +1,160 @@
+///
+//  PipelineStats.cpp
+//
+//  Per-stage timing and counters for the 2D pipeline
+//
+//  Statistics are only gathered when the code is compiled with
+//  -DPIPELINE_STATS; otherwise the STATS_* macros expand to nothing,
+//  and the reporting functions report empty statistics.
+//
+//  Contributor:  Jimmy Dugan
+///
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "PipelineStats.h"
+
+using namespace std;
+
+#ifdef PIPELINE_STATS
+
+// printable names of the stages
+static const char *stageNames[N_STAGES] = {
+    "transform", "clip", "viewport", "raster"
+};
+
+PipelineStats pipelineStats;
+
+//struct to hold one timed run of a stage
+struct traceEvent {
+    PipelineStage stage;
+    long long start;
+    long long duration;
+};
+
+// recorded runs, capped so that long sessions can't exhaust memory
+static vector<traceEvent> traceEvents;
+static const size_t maxTraceEvents = 1000000;
+
+///
+// statsClock
+//
+// @return a monotonic timestamp in nanoseconds
+///
+long long statsClock( void ) {
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+///
+// statsRecord
+//
+// Account for one run of a stage that started at 'start'.
+//
+// @param stage  the stage that ran
+// @param start  the statsClock() value when it began
+///
+void statsRecord( PipelineStage stage, long long start ) {
+    long long duration = statsClock() - start;
+    pipelineStats.stageNs[stage] += duration;
+    pipelineStats.stageCalls[stage] += 1;
+    if( traceEvents.size() < maxTraceEvents ) {
+        traceEvents.push_back( traceEvent { stage, start, duration } );
+    }
+}
+
+#else
+
+// with statistics compiled out, everything reads as zero
+static PipelineStats pipelineStats;
+
+#endif
+
+///
+// resetPipelineStats
+//
+// Zero all counters and discard all recorded trace events.
+///
+void resetPipelineStats( void ) {
+    pipelineStats = PipelineStats();
+#ifdef PIPELINE_STATS
+    traceEvents.clear();
+#endif
+}
+
+///
+// getPipelineStats
+//
+// @return the statistics gathered since the last reset
+///
+const PipelineStats &getPipelineStats( void ) {
+    return pipelineStats;
+}
+
+///
+// printPipelineStats
+//
+// Print a summary of the statistics gathered since the last reset.
+//
+// @param out   where to print the summary
+///
+void printPipelineStats( ostream &out ) {
+#ifndef PIPELINE_STATS
+    out << "Pipeline statistics not compiled in (build with -DPIPELINE_STATS)" << endl;
+#else
+    const PipelineStats &s = pipelineStats;
+
+    out << "Pipeline statistics:" << endl;
+    for( int stage = 0; stage < N_STAGES; ++stage ) {
+        long long calls = s.stageCalls[stage];
+        out << "  " << stageNames[stage] << ": " << calls << " runs, "
+            << s.stageNs[stage] << " ns";
+        if( calls > 0 ) {
+            out << " (" << s.stageNs[stage] / calls << " ns/run)";
+        }
+        out << endl;
+    }
+    out << "  polygons: " << s.polygonsDrawn << " drawn, "
+        << s.polygonsCulled << " culled, "
+        << s.polygonsCollapsed << " collapsed to a pixel" << endl;
+    out << "  clipper vertices: " << s.clipVerticesIn << " in, "
+        << s.clipVerticesOut << " out" << endl;
+    out << "  rasterizer: " << s.spans << " spans, "
+        << s.pixels << " pixels" << endl;
+#endif
+}
+
+///
+// writeChromeTrace
+//
+// Write the recorded stage timings as a Chrome trace (JSON), which
+// can be loaded into chrome://tracing or Perfetto.
+//
+// @param path  name of the file to write
+//
+// @return true on success, false if the file could not be written
+///
+bool writeChromeTrace( const char *path ) {
+    FILE *fp = fopen( path, "w" );
+    if( fp == NULL ) {
+        perror( path );
+        return false;
+    }
+
+    fputs( "{\"traceEvents\":[", fp );
+#ifdef PIPELINE_STATS
+    // timestamps and durations are in microseconds, relative to the first event
+    long long origin = traceEvents.empty() ? 0 : traceEvents[0].start;
+    for( size_t i = 0; i < traceEvents.size(); ++i ) {
+        const traceEvent &e = traceEvents[i];
+        fprintf( fp, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+                 "\"ts\":%.3f,\"dur\":%.3f}", i ? "," : "",
+                 stageNames[e.stage], (e.start - origin) / 1000.0,
+                 e.duration / 1000.0 );
+    }
+#endif
+    fputs( "\n],\"displayTimeUnit\":\"ns\"}\n", fp );
+
+    return fclose( fp ) == 0;
+}
@@ -0,0 +1,115 @@
+///
+//  PipelineStats.h
+//
+//  Per-stage timing and counters for the 2D pipeline
+//
+//  Statistics are only gathered when the code is compiled with
+//  -DPIPELINE_STATS; otherwise the STATS_* macros expand to nothing,
+//  and the reporting functions report empty statistics.
+//
+//  Contributor:  Jimmy Dugan
+///
+
+#ifndef _PIPELINESTATS_H_
+#define _PIPELINESTATS_H_
+
+#include <iostream>
+
+using namespace std;
+
+///
+// Pipeline stages that are timed
+///
+typedef enum pStage {
+    STAGE_TRANSFORM, STAGE_CLIP, STAGE_VIEWPORT, STAGE_RASTER,
+    N_STAGES
+} PipelineStage;
+
+///
+// Accumulated statistics
+///
+typedef struct st_pstats {
+    long long stageNs[N_STAGES];        // total time spent in each stage
+    long long stageCalls[N_STAGES];     // number of times each stage ran
+    long long polygonsDrawn;            // polygons sent to the rasterizer
+    long long polygonsCulled;           // polygons with nothing to draw
+    long long polygonsCollapsed;        // polygons drawn as a single pixel
+    long long clipVerticesIn;           // vertices entering the clipper
+    long long clipVerticesOut;          // vertices leaving the clipper
+    long long spans;                    // spans filled by the rasterizer
+    long long pixels;                   // pixels emitted by the rasterizer
+} PipelineStats;
+
+///
+// resetPipelineStats
+//
+// Zero all counters and discard all recorded trace events.
+///
+void resetPipelineStats( void );
+
+///
+// getPipelineStats
+//
+// @return the statistics gathered since the last reset
+///
+const PipelineStats &getPipelineStats( void );
+
+///
+// printPipelineStats
+//
+// Print a summary of the statistics gathered since the last reset.
+//
+// @param out   where to print the summary
+///
+void printPipelineStats( ostream &out );
+
+///
+// writeChromeTrace
+//
+// Write the recorded stage timings as a Chrome trace (JSON), which
+// can be loaded into chrome://tracing or Perfetto.
+//
+// @param path  name of the file to write
+//
+// @return true on success, false if the file could not be written
+///
+bool writeChromeTrace( const char *path );
+
+#ifdef PIPELINE_STATS
+
+// the statistics themselves
+extern PipelineStats pipelineStats;
+
+///
+// statsClock
+//
+// @return a monotonic timestamp in nanoseconds
+///
+long long statsClock( void );
+
+///
+// statsRecord
+//
+// Account for one run of a stage that started at 'start'.
+//
+// @param stage  the stage that ran
+// @param start  the statsClock() value when it began
+///
+void statsRecord( PipelineStage stage, long long start );
+
+// time the code between STATS_BEGIN(stage) and STATS_END(stage)
+#define STATS_BEGIN(stage)      long long statsStart##stage = statsClock()
+#define STATS_END(stage)        statsRecord( stage, statsStart##stage )
+
+// add 'n' to one of the PipelineStats counters
+#define STATS_COUNT(counter, n) (pipelineStats.counter += (n))
+
+#else
+
+#define STATS_BEGIN(stage)
+#define STATS_END(stage)
+#define STATS_COUNT(counter, n)
+
+#endif
+
+#endif
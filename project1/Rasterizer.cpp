@@ -18,6 +18,7 @@
 #include "Types.h"
 #include "Rasterizer.h"
 #include "Canvas.h"
+#include "PipelineStats.h"
 
 using namespace std;
 
@@ -136,6 +137,8 @@ void Rasterizer::drawPolygon(int n, const Vertex v[]) {
             edge nextEdge = * nextEdgeIter;
             float startIndex = floor(currEdge.xVal);
             float endIndex = ceil(nextEdge.xVal);
+            STATS_COUNT(spans, 1);
+            STATS_COUNT(pixels, max(int(endIndex - startIndex) + 1, 0));
 
             for (int xValIter = startIndex; xValIter <= endIndex; xValIter++) {
                 Vertex v = {